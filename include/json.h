@@ -23,54 +23,121 @@ typedef enum JSON_Element_Type {
     JSON_PARSE_ERROR,//JSON_PARSE_ERROR is a JSON_STRING that describes the error that happened during json_parse
 } JSON_Element_Type;
 
+//every element is 16 bytes: a header word holding the type in its low 4 bits, and a payload word
+//read the type through elem->type, strings through json_string_data/json_string_length
+
 typedef struct JSON_Object_Table JSON_Object_Table;
 
 typedef struct JSON_Object {
-    JSON_Element_Type type;
+    uint64_t type:4;
     JSON_Object_Table * tbl;
 } JSON_Object;
 
 JSON_Object * json_make_object();
 
+void json_init_object(JSON_Object *);//initializes an empty object in place, e.g. in an element returned by json_*_emplace
+
+//json_object_get/json_object_get_n/json_object_next only read, what they return may be shared with a clone (see json_clone)
+//never modify it or pass it, or anything inside it, to a function that modifies, reach it with json_object_get_mut for that
+
 JSON_Element * json_object_get(JSON_Object *,const char * key);//pointers returned from this are 'fragile' they may break when modifying the object
 JSON_Element * json_object_get_n(JSON_Object *,const char * key,size_t n);//pointers returned from this are 'fragile' they may break when modifying the object
 
+JSON_Element * json_object_get_mut(JSON_Object *,const char * key);//same as json_object_get, for modifying the entry in place, see json_clone
+JSON_Element * json_object_get_mut_n(JSON_Object *,const char * key,size_t n);
+
 void json_object_set(JSON_Object *,const char * key,JSON_Element * elem);//elem pointer is invalidated
 void json_object_set_n(JSON_Object *,const char * key,size_t n,JSON_Element * elem);//elem pointer is invalidated
 
+JSON_Element * json_object_emplace(JSON_Object *,const char * key);//returns the entry for key, set to JSON_NULL (freeing the previous value), to be filled in place, pointers returned from this are 'fragile'
+JSON_Element * json_object_emplace_n(JSON_Object *,const char * key,size_t n);
+
+int json_object_remove(JSON_Object *,const char * key);//returns 1 if key wasn't found
+int json_object_remove_n(JSON_Object *,const char * key,size_t n);//returns 1 if key wasn't found
+
+size_t json_object_size(JSON_Object *);
+
+typedef struct JSON_Object_Iterator {
+    uint32_t bucket;
+    uint32_t index;
+} JSON_Object_Iterator;
+
+int json_object_next(JSON_Object *,JSON_Object_Iterator * it,const char ** key,JSON_Element ** elem);//iterator must be zero-initialized, returns 0 when there are no more entries, pointers returned from this are 'fragile'
+int json_object_next_n(JSON_Object *,JSON_Object_Iterator * it,const char ** key,size_t * key_len,JSON_Element ** elem);//same as json_object_next, also returns the key length
+
 void json_free_object(JSON_Object *);
 
 typedef struct JSON_Array {
-    JSON_Element_Type type;
-    size_t size;
-    size_t alloc;
-    JSON_Element * arr;
+    uint64_t type:4;
+    uint64_t packed:4;//JSON_INTEGER or JSON_DOUBLE if the items are stored as plain values, see JSON_PARSE_PACK_NUMBERS
+    uint64_t size:56;
+    union {
+        JSON_Element * arr;//the reference count and capacity are stored right before arr[0], in the same block
+        int64_t * ints;//packed JSON_INTEGER items
+        double * doubles;//packed JSON_DOUBLE items
+    };
 } JSON_Array;
 
 JSON_Array * json_make_array();
 
+void json_init_array(JSON_Array *);//initializes an empty array in place
+
 void json_free_array(JSON_Array *);
 
-JSON_Element * json_array_get(JSON_Array * arr,size_t index);//pointers returned from this are 'fragile' they may break when modifying the array
+//json_array_get and json_array_item only read, same as json_object_get, reach items to modify with json_array_get_mut
+
+JSON_Element * json_array_get(JSON_Array * arr,size_t index);//returns NULL for packed arrays, pointers returned from this are 'fragile' they may break when modifying the array
+
+JSON_Element * json_array_item(JSON_Array * arr,size_t index,JSON_Element * tmp);//same as json_array_get, but items of packed arrays are copied into tmp, which is returned
+
+JSON_Element * json_array_get_mut(JSON_Array * arr,size_t index);//same as json_array_get, for modifying the item in place, see json_clone
 
 void json_array_set(JSON_Array * arr,JSON_Element * elem,size_t index);//elem pointer is invalidated
 
 void json_array_push(JSON_Array * arr,JSON_Element * elem);//elem pointer is invalidated
 
+JSON_Element * json_array_emplace(JSON_Array * arr);//appends a JSON_NULL entry and returns it, to be filled in place, pointers returned from this are 'fragile'
+
 int json_array_insert(JSON_Array * arr,JSON_Element * elem,size_t index);//if returns 1, insertion failed and passed elem pointer is still valid, otherwise elem pointer is invalidated
 
 void json_array_remove(JSON_Array * arr,size_t index);
 
+//packed arrays hold only integers or only doubles, as an int64_t[] or double[]
+//json_array_get never modifies the array, so it returns NULL for them, json_array_get_mut and every function that modifies the array unpack it into elements first
+//read it through json_array_item or these to keep it packed
+
+double * json_array_as_doubles(JSON_Array * arr);//the items of an array packed as doubles, NULL for any other array
+
+int64_t * json_array_as_ints(JSON_Array * arr);//the items of an array packed as integers, NULL for any other array
+
+int json_array_pack(JSON_Array * arr);//packs arr if its items are all integers or all doubles, returns 1 if arr is packed
+
+void json_array_unpack(JSON_Array * arr);//stores the items as elements again, does nothing if arr isn't packed
+
+#define JSON_STRING_INLINE_MAX 14//longest string stored inside the element, null-terminated at byte 15
+#define JSON_STRING_HEAP 15
+
 typedef struct JSON_String {
-    JSON_Element_Type type;
-    size_t len;
-    char * str;
+    uint64_t type:4;
+    uint64_t small:4;//length of an inline string, whose chars start at byte 1, or JSON_STRING_HEAP
+    uint64_t heap_len:56;//only valid for heap strings
+    char * heap_str;
 } JSON_String;
 
+static inline size_t json_string_length(const JSON_String * str){
+    return str->small==JSON_STRING_HEAP?(size_t)str->heap_len:(size_t)str->small;
+}
+
+static inline char * json_string_data(JSON_String * str){//null-terminated
+    return str->small==JSON_STRING_HEAP?str->heap_str:(char*)str+1;
+}
+
 JSON_String * json_make_string(const char * s);
 
 JSON_String * json_make_string_n(const char * s,size_t n);
 
+void json_init_string_n(JSON_String * str,const char * s,size_t n);//initializes a string in place
+
 void json_set_string(JSON_String * str,const char * s);
 
 void json_set_string_n(JSON_String * str,const char * s,size_t n);
@@ -78,14 +145,14 @@ void json_set_string_n(JSON_String * str,const char * s,size_t n);
 void json_free_string(JSON_String *);
 
 typedef struct JSON_Integer {
-    JSON_Element_Type type;
+    uint64_t type:4;
     int64_t i;
 } JSON_Integer;
 
 JSON_Integer * json_make_integer(int64_t i);
 
 typedef struct JSON_Double {
-    JSON_Element_Type type;
+    uint64_t type:4;
     double d;
 } JSON_Double;
 
@@ -93,7 +160,7 @@ JSON_Double * json_make_double(double d);
 
 struct JSON_Element {
     union {
-        JSON_Element_Type type;
+        uint64_t type:4;//a JSON_Element_Type
         JSON_Array _arr;
         JSON_Object _obj;
         JSON_String _str;
@@ -104,10 +171,57 @@ struct JSON_Element {
 
 void json_free_element(JSON_Element *);
 
+void json_cleanup_element(JSON_Element *);//frees the contents of the element, but not the element itself
+
+//json_clone doesn't copy arrays and objects, the copy shares them with the original, they're reference counted and copied on write
+//functions that modify an array or object first give it its own copy if it's shared, copying only that level, so other versions never see the change
+//a container below a shared one has a count of 1 until the level above it is copied, so that's only safe for containers reached through the *_mut functions:
+//writing to one reached through a plain getter changes every version that shares it, and can't be detected
+//entries reached through json_object_get/json_array_get/json_array_item/json_object_next, and packed items from json_array_as_ints/json_array_as_doubles,
+//may belong to a shared container, only read through them
+//to modify a nested value, reach it with json_object_get_mut/json_array_get_mut (or json_pointer_get_mut), which unshare the path down to it
+//cloning a container shares everything below it again, so pointers into it must be looked up again before modifying through them
+//separate versions can be read, cloned, modified and freed from different threads, a single version can only be read concurrently
+
+JSON_Element * json_clone(JSON_Element *);//copy that shares arrays and objects with elem, O(1) except for strings longer than JSON_STRING_INLINE_MAX and arena documents, which are copied
+
+int json_equal(JSON_Element * a,JSON_Element * b);//returns 1 if both trees have the same contents, object entry order is ignored
+
+uint64_t json_hash(JSON_Element *);//stable content hash, equal trees always have equal hashes
+
 JSON_Element * json_parse_n(const char * s,size_t n);
 
 JSON_Element * json_parse(const char * s);
 
+#define JSON_PARSE_VALIDATE_UTF8 0x1//reject strings that aren't valid UTF-8, checked in the same pass that scans them
+#define JSON_PARSE_PACK_NUMBERS 0x2//store arrays of only integers or only doubles packed, without an element per item, json_parser.h ignores this
+
+JSON_Element * json_parse_flags_n(const char * s,size_t n,uint32_t flags);
+
+JSON_Element * json_parse_flags(const char * s,uint32_t flags);
+
+//allocation-free error reporting, json_parse_* build their JSON_PARSE_ERROR elements from these
+
+typedef enum JSON_Error_Code {
+    JSON_ERROR_NONE,
+    JSON_ERROR_UNEXPECTED,//found got where the grammar allows expected
+    JSON_ERROR_INVALID_ESCAPE,//malformed \u escape or lone surrogate
+    JSON_ERROR_INVALID_UTF8,//only with JSON_PARSE_VALIDATE_UTF8
+} JSON_Error_Code;
+
+typedef struct JSON_Error {
+    JSON_Error_Code code;
+    int got;//byte found at offset, -1 at EOF
+    const char * expected;//static string, NULL if code isn't JSON_ERROR_UNEXPECTED
+    size_t offset;//byte offset into the input
+} JSON_Error;
+
+JSON_Element * json_try_parse_n(const char * s,size_t n,uint32_t flags,JSON_Error * error);//returns NULL on failure and fills error (may be NULL), nothing is allocated for the error
+
+size_t json_error_message(const JSON_Error * error,char * buf,size_t size);//formats like snprintf, returns the length of the full message
+
+void json_error_location(const JSON_Error * error,const char * s,size_t n,size_t * line,size_t * column);//1-based line and column of the error in s, only computed when asked for
+
 void json_write_element(FILE *f,JSON_Element *,size_t indentation);
 void json_write_object(FILE *f,JSON_Object *,size_t indentation);
 void json_write_array(FILE *f,JSON_Array *,size_t indentation);
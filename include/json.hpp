@@ -0,0 +1,383 @@
+#pragma once
+
+#include "json.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+//header-only C++17 layer over the C api
+//Document and Value own their trees and are move-only, ValueRef is a non-owning view into a tree
+//everything is inline and maps directly to the C calls, values are moved into place instead of going through a heap element
+
+namespace json {
+
+enum class Type {
+    Null=JSON_NULL,
+    Array=JSON_ARRAY,
+    Object=JSON_OBJECT,
+    Integer=JSON_INTEGER,
+    Double=JSON_DOUBLE,
+    String=JSON_STRING,
+    True=JSON_TRUE,
+    False=JSON_FALSE,
+};
+
+class parse_error : public std::runtime_error {
+    JSON_Error err{};
+    static std::string message(const JSON_Error &e){
+        char msg[128];
+        json_error_message(&e,msg,sizeof(msg));
+        return msg;
+    }
+public:
+    using std::runtime_error::runtime_error;
+    explicit parse_error(const JSON_Error &e):std::runtime_error(message(e)),err(e){}
+    const JSON_Error & error() const {return err;}//code is JSON_ERROR_NONE for errors that didn't come from the lexer
+};
+
+class Value;
+class ValueRef;
+
+class ArrayIterator {//reads items with json_array_item, packed arrays stay packed
+    JSON_Array * arr;
+    size_t i;
+public:
+    using iterator_category=std::random_access_iterator_tag;
+    using value_type=ValueRef;
+    using difference_type=std::ptrdiff_t;
+    using pointer=void;
+    using reference=ValueRef;
+
+    ArrayIterator(JSON_Array * arr,size_t i):arr(arr),i(i){}
+    inline ValueRef operator*() const;
+    inline ValueRef operator[](difference_type n) const;
+    ArrayIterator & operator++(){++i;return *this;}
+    ArrayIterator operator++(int){return ArrayIterator(arr,i++);}
+    ArrayIterator & operator--(){--i;return *this;}
+    ArrayIterator operator--(int){return ArrayIterator(arr,i--);}
+    ArrayIterator & operator+=(difference_type n){i+=n;return *this;}
+    ArrayIterator & operator-=(difference_type n){i-=n;return *this;}
+    ArrayIterator operator+(difference_type n) const {return ArrayIterator(arr,i+n);}
+    ArrayIterator operator-(difference_type n) const {return ArrayIterator(arr,i-n);}
+    difference_type operator-(const ArrayIterator &o) const {return static_cast<difference_type>(i-o.i);}
+    bool operator==(const ArrayIterator &o) const {return i==o.i;}
+    bool operator!=(const ArrayIterator &o) const {return i!=o.i;}
+    bool operator<(const ArrayIterator &o) const {return i<o.i;}
+};
+
+class ObjectIterator {
+    JSON_Object * obj;
+    JSON_Object_Iterator it;
+    const char * key;
+    size_t key_len;
+    JSON_Element * elem;
+    void next(){
+        if(!json_object_next_n(obj,&it,&key,&key_len,&elem))obj=nullptr;
+    }
+public:
+    using iterator_category=std::forward_iterator_tag;
+    using value_type=std::pair<std::string_view,ValueRef>;
+    using difference_type=std::ptrdiff_t;
+    using pointer=void;
+    using reference=value_type;
+
+    explicit ObjectIterator(JSON_Object * obj):obj(obj),it{0,0},key(nullptr),key_len(0),elem(nullptr){
+        if(obj)next();
+    }
+    inline std::pair<std::string_view,ValueRef> operator*() const;
+    ObjectIterator & operator++(){next();return *this;}
+    ObjectIterator operator++(int){ObjectIterator tmp=*this;next();return tmp;}
+    bool operator==(const ObjectIterator &o) const {return obj==o.obj&&(!obj||elem==o.elem);}
+    bool operator!=(const ObjectIterator &o) const {return !(*this==o);}
+};
+
+template<typename It>
+class Range {
+    It b;
+    It e;
+public:
+    Range(It b,It e):b(b),e(e){}
+    It begin() const {return b;}
+    It end() const {return e;}
+};
+
+//accessors shared by Document, Value and ValueRef, none of them check the type of the element, use the is_* functions first
+
+template<typename Derived>
+class Access {
+    JSON_Element * el() const {return static_cast<const Derived*>(this)->get();}
+public:
+    Type type() const {return static_cast<Type>(el()->type);}
+    bool is_null() const {return el()->type==JSON_NULL;}
+    bool is_array() const {return el()->type==JSON_ARRAY;}
+    bool is_object() const {return el()->type==JSON_OBJECT;}
+    bool is_integer() const {return el()->type==JSON_INTEGER;}
+    bool is_double() const {return el()->type==JSON_DOUBLE;}
+    bool is_number() const {return el()->type==JSON_INTEGER||el()->type==JSON_DOUBLE;}
+    bool is_string() const {return el()->type==JSON_STRING;}
+    bool is_bool() const {return el()->type==JSON_TRUE||el()->type==JSON_FALSE;}
+
+    bool as_bool() const {return el()->type==JSON_TRUE;}
+    int64_t as_int() const {return el()->_int.i;}
+    double as_double() const {return el()->type==JSON_INTEGER?static_cast<double>(el()->_int.i):el()->_double.d;}//also converts integers
+    std::string_view as_string() const {return std::string_view(json_string_data(&el()->_str),json_string_length(&el()->_str));}//points into the element for short strings, invalidated when it moves
+    const char * c_str() const {return json_string_data(&el()->_str);}
+
+    size_t size() const {//number of entries of arrays and objects, length of strings
+        switch(el()->type){
+        case JSON_ARRAY:
+            return el()->_arr.size;
+        case JSON_OBJECT:
+            return json_object_size(&el()->_obj);
+        case JSON_STRING:
+            return json_string_length(&el()->_str);
+        default:
+            return 0;
+        }
+    }
+
+    template<typename I,std::enable_if_t<std::is_integral_v<I>,int> =0>
+    inline ValueRef operator[](I index) const;//empty ValueRef if out of range, items of packed arrays are read into the ValueRef without unpacking
+    inline ValueRef operator[](std::string_view key) const;//empty ValueRef if not found
+
+    //same lookups for modifying the result in place, clones share arrays and objects until they're modified, see json_clone
+    //these copy the shared ones on the way, [], items() and entries() only read: never modify through them in a tree that may share containers with a clone
+
+    template<typename I,std::enable_if_t<std::is_integral_v<I>,int> =0>
+    inline ValueRef edit(I index) const;
+    inline ValueRef edit(std::string_view key) const;
+
+    Range<ArrayIterator> items() const {//only reads, same as [], items of packed arrays are read by value
+        return Range<ArrayIterator>(ArrayIterator(&el()->_arr,0),ArrayIterator(&el()->_arr,el()->_arr.size));
+    }
+
+    Range<ObjectIterator> entries() const {
+        return Range<ObjectIterator>(ObjectIterator(&el()->_obj),ObjectIterator(nullptr));
+    }
+
+    //modifying the tree invalidates ValueRefs and iterators into the modified array or object, same as the C api
+    //assign and take modify the element itself, in a tree that shares containers with a clone it must come from edit
+
+    inline ValueRef push(Value && v) const;//arrays only, returns the inserted entry
+    inline ValueRef set(std::string_view key,Value && v) const;//objects only, returns the inserted entry
+    inline void assign(Value && v) const;//replaces this element
+
+    bool remove(std::string_view key) const {return json_object_remove_n(&el()->_obj,key.data(),key.size())==0;}
+    void remove(size_t index) const {json_array_remove(&el()->_arr,index);}
+
+    inline Value take() const;//moves this element out, leaving JSON_NULL in its place
+    inline Value clone() const;//shares arrays and objects with this one instead of copying them
+
+    template<typename T>
+    bool equal(const Access<T> &o) const {return json_equal(el(),static_cast<const T&>(o).get());}
+    uint64_t hash() const {return json_hash(el());}
+
+    void write(FILE * f,size_t indentation=0) const {json_write_element(f,el(),indentation);}
+};
+
+class ValueRef : public Access<ValueRef> {
+    JSON_Element * e;
+    JSON_Element item;//copy of an item of a packed array, which has no element to point to, writing to it doesn't reach the array
+public:
+    ValueRef(JSON_Element * e=nullptr):e(e),item{}{}
+    ValueRef(JSON_Array * arr,size_t index):e(nullptr){//same as json_array_item
+        e=json_array_item(arr,index,&item);
+    }
+    ValueRef(const ValueRef &o):item(o.item){
+        e=o.e==&o.item?&item:o.e;
+    }
+    ValueRef & operator=(const ValueRef &o){
+        item=o.item;
+        e=o.e==&o.item?&item:o.e;
+        return *this;
+    }
+    explicit operator bool() const {return e!=nullptr;}
+    JSON_Element * get() const {return e;}
+};
+
+class Value : public Access<Value> {
+    JSON_Element e;
+
+    void reset(){
+        std::memset(&e,0,sizeof(e));
+        e.type=JSON_NULL;
+    }
+    template<typename>
+    friend class Access;
+    friend class Document;
+    static Value adopt(JSON_Element * elem){//takes over a heap element from the C api
+        Value v;
+        std::memcpy(&v.e,elem,sizeof(JSON_Element));
+        std::free(elem);
+        return v;
+    }
+    void move_to(JSON_Element * dst){
+        std::memcpy(dst,&e,sizeof(JSON_Element));
+        reset();
+    }
+public:
+    Value(){reset();}
+    Value(std::nullptr_t){reset();}
+    Value(bool b){
+        reset();
+        e.type=b?JSON_TRUE:JSON_FALSE;
+    }
+    template<typename T,std::enable_if_t<std::is_integral_v<T>&&!std::is_same_v<T,bool>,int> =0>
+    Value(T i){
+        reset();
+        e._int.type=JSON_INTEGER;
+        e._int.i=static_cast<int64_t>(i);
+    }
+    Value(double d){
+        reset();
+        e._double.type=JSON_DOUBLE;
+        e._double.d=d;
+    }
+    Value(std::string_view s){
+        reset();
+        json_init_string_n(&e._str,s.data(),s.size());
+    }
+    Value(const char * s):Value(std::string_view(s)){}
+    Value(const std::string &s):Value(std::string_view(s)){}
+
+    static Value array(){
+        Value v;
+        json_init_array(&v.e._arr);
+        return v;
+    }
+    static Value object(){
+        Value v;
+        json_init_object(&v.e._obj);
+        return v;
+    }
+
+    Value(Value && o){o.move_to(&e);}
+    Value & operator=(Value && o){
+        if(this!=&o){
+            json_cleanup_element(&e);
+            o.move_to(&e);
+        }
+        return *this;
+    }
+    Value(const Value &)=delete;
+    Value & operator=(const Value &)=delete;
+    ~Value(){json_cleanup_element(&e);}
+
+    JSON_Element * get() const {return const_cast<JSON_Element*>(&e);}
+    ValueRef ref() const {return ValueRef(get());}
+};
+
+class Document : public Access<Document> {
+    JSON_Element * root;
+public:
+    Document():root(nullptr){}
+    explicit Document(Value && v):root(static_cast<JSON_Element*>(std::malloc(sizeof(JSON_Element)))){
+        if(!root)throw std::bad_alloc();
+        v.move_to(root);
+    }
+    static Document adopt(JSON_Element * elem){//takes ownership of a tree from the C api
+        Document d;
+        d.root=elem;
+        return d;
+    }
+    static Document parse(std::string_view s){
+        JSON_Error error;
+        JSON_Element * elem=json_try_parse_n(s.data(),s.size(),0,&error);
+        if(!elem)throw parse_error(error);
+        return adopt(elem);
+    }
+
+    Document(Document && o):root(o.root){o.root=nullptr;}
+    Document & operator=(Document && o){
+        if(this!=&o){
+            json_free_element(root);
+            root=o.root;
+            o.root=nullptr;
+        }
+        return *this;
+    }
+    Document(const Document &)=delete;
+    Document & operator=(const Document &)=delete;
+    ~Document(){json_free_element(root);}
+
+    explicit operator bool() const {return root!=nullptr;}
+    JSON_Element * get() const {return root;}
+    ValueRef ref() const {return ValueRef(root);}
+    JSON_Element * release(){//gives ownership of the tree back to the C api
+        JSON_Element * elem=root;
+        root=nullptr;
+        return elem;
+    }
+};
+
+inline ValueRef ArrayIterator::operator*() const {return ValueRef(arr,i);}
+inline ValueRef ArrayIterator::operator[](difference_type n) const {return ValueRef(arr,i+n);}
+
+inline std::pair<std::string_view,ValueRef> ObjectIterator::operator*() const {
+    return std::pair<std::string_view,ValueRef>(std::string_view(key,key_len),ValueRef(elem));
+}
+
+template<typename Derived>
+template<typename I,std::enable_if_t<std::is_integral_v<I>,int>>
+inline ValueRef Access<Derived>::operator[](I index) const {
+    return ValueRef(&el()->_arr,static_cast<size_t>(index));
+}
+
+template<typename Derived>
+inline ValueRef Access<Derived>::operator[](std::string_view key) const {
+    return ValueRef(json_object_get_n(&el()->_obj,key.data(),key.size()));
+}
+
+template<typename Derived>
+template<typename I,std::enable_if_t<std::is_integral_v<I>,int>>
+inline ValueRef Access<Derived>::edit(I index) const {
+    return ValueRef(json_array_get_mut(&el()->_arr,static_cast<size_t>(index)));
+}
+
+template<typename Derived>
+inline ValueRef Access<Derived>::edit(std::string_view key) const {
+    return ValueRef(json_object_get_mut_n(&el()->_obj,key.data(),key.size()));
+}
+
+template<typename Derived>
+inline ValueRef Access<Derived>::push(Value && v) const {
+    JSON_Element * slot=json_array_emplace(&el()->_arr);
+    v.move_to(slot);
+    return ValueRef(slot);
+}
+
+template<typename Derived>
+inline ValueRef Access<Derived>::set(std::string_view key,Value && v) const {
+    JSON_Element * slot=json_object_emplace_n(&el()->_obj,key.data(),key.size());
+    v.move_to(slot);
+    return ValueRef(slot);
+}
+
+template<typename Derived>
+inline void Access<Derived>::assign(Value && v) const {
+    json_cleanup_element(el());
+    v.move_to(el());
+}
+
+template<typename Derived>
+inline Value Access<Derived>::take() const {
+    Value v;
+    std::memcpy(&v.e,el(),sizeof(JSON_Element));
+    std::memset(el(),0,sizeof(JSON_Element));
+    el()->type=JSON_NULL;
+    return v;
+}
+
+template<typename Derived>
+inline Value Access<Derived>::clone() const {
+    return Value::adopt(json_clone(el()));
+}
+
+}
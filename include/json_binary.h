@@ -0,0 +1,62 @@
+#pragma once
+
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+//compact binary encoding of a JSON_Element tree, meant to be reloaded much faster than re-parsing text
+//
+//layout (native byte order, every node 8-byte aligned):
+//  header : "JSNB" u32 version, u64 root offset
+//  null/true/false : u32 type, u32 pad
+//  integer/double  : u32 type, u32 pad, i64/f64 value
+//  string          : u32 type, u32 pad, u64 length, bytes, '\0', padding
+//  array           : u32 type, u32 pad, u64 count, u64 offset[count]
+//  object          : u32 type, u32 pad, u64 count, {u64 key offset, u64 value offset, u32 hash, u32 pad}[count] sorted by hash
+//
+//children are written before their container, each value node is referenced once, object keys are shared
+//
+//a JSON_Binary can be opened directly on mapped memory, all accessors read the bytes in place without copying
+
+typedef struct JSON_Binary {
+    const uint8_t * data;
+    size_t size;
+} JSON_Binary;
+
+typedef uint64_t JSON_Binary_Value;//offset of a node in the buffer, 0 means 'no value'
+
+int json_binary_open(JSON_Binary * bin,const void * data,size_t size);//returns 1 if data isn't a binary json document
+
+JSON_Binary_Value json_binary_root(const JSON_Binary * bin);
+
+JSON_Element_Type json_binary_type(const JSON_Binary * bin,JSON_Binary_Value v);//returns JSON_PARSE_ERROR for invalid values
+
+int64_t json_binary_integer(const JSON_Binary * bin,JSON_Binary_Value v);
+
+double json_binary_double(const JSON_Binary * bin,JSON_Binary_Value v);
+
+const char * json_binary_string(const JSON_Binary * bin,JSON_Binary_Value v,size_t * len);//returned pointer points into the buffer, is null-terminated
+
+size_t json_binary_size(const JSON_Binary * bin,JSON_Binary_Value v);//number of entries in an array or object
+
+JSON_Binary_Value json_binary_array_get(const JSON_Binary * bin,JSON_Binary_Value arr,size_t index);
+
+JSON_Binary_Value json_binary_object_get(const JSON_Binary * bin,JSON_Binary_Value obj,const char * key);
+JSON_Binary_Value json_binary_object_get_n(const JSON_Binary * bin,JSON_Binary_Value obj,const char * key,size_t n);
+
+const char * json_binary_object_key(const JSON_Binary * bin,JSON_Binary_Value obj,size_t index,size_t * len);
+JSON_Binary_Value json_binary_object_value(const JSON_Binary * bin,JSON_Binary_Value obj,size_t index);
+
+void * json_write_binary_buffer(JSON_Element * elem,size_t * size);//returned buffer must be freed with free
+
+int json_write_binary(FILE * f,JSON_Element * elem);//returns 1 if writing failed
+
+#define JSON_BINARY_MAX_DEPTH 10000//json_read_binary rejects deeper nesting, freeing and writing trees recurse once per level
+
+JSON_Element * json_read_binary(const void * data,size_t size);//builds a mutable tree, returns a JSON_PARSE_ERROR element on invalid data or if a value node is referenced twice
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
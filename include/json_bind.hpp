@@ -0,0 +1,576 @@
+#pragma once
+
+#include "json.hpp"
+#include "json_lexer.h"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//typed binding of C++ types to JSON, parsed straight from the text on the same tokenizer as json_parse_n without building a tree, and written back without one
+//structs are bound with JSON_BIND(Type,member...) and enums with JSON_BIND_ENUM(Type,value...), both at global scope
+//supported types: bool, integers, floating point, std::string, std::optional, std::vector, std::map<std::string,T>, enums and bound structs
+//struct keys are dispatched through a perfect hash of the field names built at compile time, unknown keys are skipped and missing fields keep their value
+//errors throw json::parse_error
+
+//helper macros, JSON_BIND_EACH(m,t,a,b,...) expands to m(t,a),m(t,b),...
+
+#define JSON_BIND_EXPAND(x) x
+#define JSON_BIND_CAT(a,b) JSON_BIND_CAT_(a,b)
+#define JSON_BIND_CAT_(a,b) a##b
+#define JSON_BIND_COUNT(...) JSON_BIND_EXPAND(JSON_BIND_COUNT_(__VA_ARGS__,48,47,46,45,44,43,42,41,40,39,38,37,36,35,34,33,32,31,30,29,28,27,26,25,24,23,22,21,20,19,18,17,16,15,14,13,12,11,10,9,8,7,6,5,4,3,2,1))
+#define JSON_BIND_COUNT_(_1,_2,_3,_4,_5,_6,_7,_8,_9,_10,_11,_12,_13,_14,_15,_16,_17,_18,_19,_20,_21,_22,_23,_24,_25,_26,_27,_28,_29,_30,_31,_32,_33,_34,_35,_36,_37,_38,_39,_40,_41,_42,_43,_44,_45,_46,_47,_48,N,...) N
+#define JSON_BIND_EACH_1(m,t,x) m(t,x)
+#define JSON_BIND_EACH_2(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_1(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_3(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_2(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_4(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_3(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_5(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_4(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_6(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_5(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_7(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_6(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_8(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_7(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_9(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_8(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_10(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_9(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_11(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_10(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_12(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_11(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_13(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_12(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_14(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_13(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_15(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_14(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_16(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_15(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_17(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_16(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_18(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_17(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_19(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_18(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_20(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_19(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_21(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_20(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_22(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_21(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_23(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_22(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_24(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_23(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_25(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_24(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_26(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_25(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_27(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_26(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_28(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_27(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_29(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_28(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_30(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_29(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_31(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_30(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_32(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_31(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_33(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_32(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_34(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_33(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_35(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_34(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_36(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_35(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_37(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_36(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_38(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_37(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_39(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_38(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_40(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_39(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_41(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_40(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_42(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_41(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_43(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_42(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_44(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_43(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_45(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_44(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_46(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_45(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_47(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_46(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH_48(m,t,x,...) m(t,x),JSON_BIND_EXPAND(JSON_BIND_EACH_47(m,t,__VA_ARGS__))
+#define JSON_BIND_EACH(m,t,...) JSON_BIND_EXPAND(JSON_BIND_CAT(JSON_BIND_EACH_,JSON_BIND_COUNT(__VA_ARGS__))(m,t,__VA_ARGS__))
+
+namespace json {
+namespace bind {
+
+template<typename C,typename M>
+struct field {
+    using member_type=M;
+    std::string_view name;
+    M C::* member;
+};
+
+template<typename C,typename M>
+constexpr field<C,M> make_field(const char * name,M C::* member){
+    return field<C,M>{std::string_view(name),member};
+}
+
+template<typename T>
+struct fields;//specialized by JSON_BIND, holds a constexpr tuple of fields
+
+template<typename T>
+struct enum_values;//specialized by JSON_BIND_ENUM, holds a constexpr array of name/value pairs
+
+template<typename T,typename=void>
+struct is_bound : std::false_type {};
+
+template<typename T>
+struct is_bound<T,std::void_t<decltype(fields<T>::value)>> : std::true_type {};
+
+template<typename T,typename=void>
+struct is_bound_enum : std::false_type {};
+
+template<typename T>
+struct is_bound_enum<T,std::void_t<decltype(enum_values<T>::value)>> : std::true_type {};
+
+template<typename T>
+struct is_optional : std::false_type {};
+
+template<typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+//perfect hashing of field names, tries the length plus first and last chars first, and the whole key if those collide
+
+constexpr uint32_t key_hash(std::string_view key,uint32_t seed,bool full){
+    uint32_t h=(seed^static_cast<uint32_t>(key.size()))*16777619u;
+    if(full){
+        for(size_t i=0;i<key.size();i++){
+            h=(h^static_cast<unsigned char>(key[i]))*16777619u;
+        }
+    }else if(!key.empty()){
+        h=(h^static_cast<unsigned char>(key[0]))*16777619u;
+        h=(h^static_cast<unsigned char>(key[key.size()-1]))*16777619u;
+    }
+    return h^(h>>15);
+}
+
+template<size_t N>
+struct key_table {
+    static constexpr size_t size=[]{
+        size_t s=1;
+        while(s<N*2)s*=2;
+        return s;
+    }();
+    bool found=false;
+    bool full=false;
+    uint32_t seed=0;
+    std::array<int,size> slots{};
+};
+
+template<size_t N>
+constexpr key_table<N> make_key_table(const std::array<std::string_view,N> &names){
+    key_table<N> t;
+    for(int full=0;full<2;full++){
+        for(uint32_t seed=0;seed<256;seed++){
+            for(size_t i=0;i<t.size;i++)t.slots[i]=-1;
+            bool ok=true;
+            for(size_t i=0;ok&&i<N;i++){
+                size_t h=key_hash(names[i],seed,full)&(t.size-1);
+                if(t.slots[h]>=0){
+                    ok=false;
+                }else{
+                    t.slots[h]=static_cast<int>(i);
+                }
+            }
+            if(ok){
+                t.found=true;
+                t.full=full;
+                t.seed=seed;
+                return t;
+            }
+        }
+    }
+    return t;
+}
+
+//tokenizer helpers
+
+[[noreturn]] inline void fail(JSON_Lexer * p){//throws the error recorded in p->error
+    throw parse_error(p->error);
+}
+
+inline void check(JSON_Lexer * p,bool ok){
+    if(!ok)fail(p);
+}
+
+[[noreturn]] inline void fail_expected(JSON_Lexer * p,const char * what){
+    json_lex_unexpected(p,what);
+    fail(p);
+}
+
+inline bool peek(JSON_Lexer * p,char c){
+    json_lex_whitespace(p);
+    return p->i<p->n&&p->s[p->i]==c;
+}
+
+inline void expect(JSON_Lexer * p,char c){
+    if(!peek(p,c)){
+        char what[4]={'\'',c,'\'',0};
+        fail_expected(p,what);
+    }
+    ++p->i;
+}
+
+inline bool begin(JSON_Lexer * p,char open,char close){//returns false if the container is empty
+    expect(p,open);
+    if(peek(p,close)){
+        ++p->i;
+        return false;
+    }
+    return true;
+}
+
+inline bool next(JSON_Lexer * p,char close){//returns false at the end of the container, a trailing comma is allowed like in json_parse_n
+    json_lex_whitespace(p);
+    if(p->i<p->n&&p->s[p->i]==','){
+        ++p->i;
+        if(peek(p,close)){
+            ++p->i;
+            return false;
+        }
+        return true;
+    }else if(p->i<p->n&&p->s[p->i]==close){
+        ++p->i;
+        return false;
+    }
+    char what[4]={'\'',close,'\'',0};
+    fail_expected(p,what);
+}
+
+inline std::string_view read_key(JSON_Lexer * p,std::string &buf){
+    //keys without escapes are returned straight from the input
+    size_t len;
+    check(p,json_lex_string_length(p,&len));
+    size_t start=p->i+1;
+    json_lex_string_copy(p,nullptr);
+    if(p->i-start-1==len)return std::string_view(p->s+start,len);
+    p->i=start-1;
+    buf.resize(len);
+    json_lex_string_copy(p,&buf[0]);
+    return buf;
+}
+
+inline void write_string(std::string &out,std::string_view s){
+    static const char hex[]="0123456789abcdef";
+    out+='"';
+    size_t run=0;//unescaped chars are appended in runs
+    for(size_t i=0;i<s.size();i++){
+        unsigned char c=static_cast<unsigned char>(s[i]);
+        if(c>=0x20&&c!='"'&&c!='\\')continue;
+        out.append(s.data()+run,i-run);
+        run=i+1;
+        out+='\\';
+        switch(c){
+        case '"':
+            out+='"';
+            break;
+        case '\\':
+            out+='\\';
+            break;
+        case '\b':
+            out+='b';
+            break;
+        case '\f':
+            out+='f';
+            break;
+        case '\n':
+            out+='n';
+            break;
+        case '\r':
+            out+='r';
+            break;
+        case '\t':
+            out+='t';
+            break;
+        default:
+            out+="u00";
+            out+=hex[c>>4];
+            out+=hex[c&0xF];
+            break;
+        }
+    }
+    out.append(s.data()+run,s.size()-run);
+    out+='"';
+}
+
+template<typename T,typename=void>
+struct codec;//read(JSON_Lexer*,T&) and write(std::string&,const T&) for every supported type
+
+template<>
+struct codec<bool> {
+    static void read(JSON_Lexer * p,bool &out){
+        json_lex_whitespace(p);
+        JSON_Element_Type type=json_lex_literal(p);
+        if(type!=JSON_TRUE&&type!=JSON_FALSE)fail_expected(p,"boolean");
+        out=type==JSON_TRUE;
+    }
+    static void write(std::string &out,bool v){
+        out+=v?"true":"false";
+    }
+};
+
+template<typename T>
+struct codec<T,std::enable_if_t<std::is_integral_v<T>&&!std::is_same_v<T,bool>>> {
+    static void read(JSON_Lexer * p,T &out){
+        JSON_Number number;
+        bool is_double;
+        check(p,json_lex_number(p,&number,&is_double));
+        if(is_double)throw parse_error("Expected integer, got number");
+        if constexpr(std::is_unsigned_v<T>){
+            if(number.i<0||static_cast<uint64_t>(number.i)>std::numeric_limits<T>::max())throw parse_error("Integer out of range");
+        }else{
+            if(number.i<std::numeric_limits<T>::min()||number.i>std::numeric_limits<T>::max())throw parse_error("Integer out of range");
+        }
+        out=static_cast<T>(number.i);
+    }
+    static void write(std::string &out,T v){
+        char buf[24];
+        out.append(buf,std::to_chars(buf,buf+sizeof(buf),v).ptr-buf);
+    }
+};
+
+template<typename T>
+struct codec<T,std::enable_if_t<std::is_floating_point_v<T>>> {
+    static void read(JSON_Lexer * p,T &out){
+        JSON_Number number;
+        bool is_double;
+        check(p,json_lex_number(p,&number,&is_double));
+        out=static_cast<T>(is_double?number.d:static_cast<double>(number.i));
+    }
+    static void write(std::string &out,T v){
+        if(!std::isfinite(v)){
+            out+="null";
+            return;
+        }
+        char buf[32];
+#ifdef __cpp_lib_to_chars
+        out.append(buf,std::to_chars(buf,buf+sizeof(buf),v).ptr-buf);
+#else
+        out.append(buf,snprintf(buf,sizeof(buf),"%.17g",static_cast<double>(v)));
+#endif
+    }
+};
+
+template<>
+struct codec<std::string> {
+    static void read(JSON_Lexer * p,std::string &out){
+        size_t len;
+        check(p,json_lex_string_length(p,&len));
+        out.resize(len);
+        json_lex_string_copy(p,&out[0]);
+    }
+    static void write(std::string &out,const std::string &v){
+        write_string(out,v);
+    }
+};
+
+template<typename T>
+struct codec<std::optional<T>> {
+    static void read(JSON_Lexer * p,std::optional<T> &out){
+        if(peek(p,'n')){
+            if(json_lex_literal(p)!=JSON_NULL)fail_expected(p,"null");
+            out.reset();
+            return;
+        }
+        out.emplace();
+        codec<T>::read(p,*out);
+    }
+    static void write(std::string &out,const std::optional<T> &v){
+        if(v){
+            codec<T>::write(out,*v);
+        }else{
+            out+="null";
+        }
+    }
+};
+
+template<typename T>
+struct codec<std::vector<T>> {
+    static void read(JSON_Lexer * p,std::vector<T> &out){
+        out.clear();
+        if(!begin(p,'[',']'))return;
+        do{
+            if constexpr(std::is_same_v<T,bool>){
+                bool b;
+                codec<bool>::read(p,b);
+                out.push_back(b);
+            }else{
+                codec<T>::read(p,out.emplace_back());
+            }
+        }while(next(p,']'));
+    }
+    static void write(std::string &out,const std::vector<T> &v){
+        out+='[';
+        for(size_t i=0;i<v.size();i++){
+            if(i)out+=',';
+            codec<T>::write(out,v[i]);
+        }
+        out+=']';
+    }
+};
+
+template<typename T>
+struct codec<std::map<std::string,T>> {
+    static void read(JSON_Lexer * p,std::map<std::string,T> &out){
+        out.clear();
+        if(!begin(p,'{','}'))return;
+        std::string buf;
+        do{
+            std::string_view key=read_key(p,buf);
+            expect(p,':');
+            codec<T>::read(p,out[std::string(key)]);
+        }while(next(p,'}'));
+    }
+    static void write(std::string &out,const std::map<std::string,T> &v){
+        out+='{';
+        bool first=true;
+        for(const auto &entry:v){
+            if(!first)out+=',';
+            first=false;
+            write_string(out,entry.first);
+            out+=':';
+            codec<T>::write(out,entry.second);
+        }
+        out+='}';
+    }
+};
+
+template<typename T>
+struct codec<T,std::enable_if_t<std::is_enum_v<T>>> {
+    //bound enums are written as their names, others as their underlying integer
+    using underlying=std::underlying_type_t<T>;
+    static void read(JSON_Lexer * p,T &out){
+        if constexpr(is_bound_enum<T>::value){
+            std::string buf;
+            std::string_view name=read_key(p,buf);
+            for(const auto &entry:enum_values<T>::value){
+                if(entry.first==name){
+                    out=entry.second;
+                    return;
+                }
+            }
+            throw parse_error("Unknown enum value '"+std::string(name)+"'");
+        }else{
+            underlying v;
+            codec<underlying>::read(p,v);
+            out=static_cast<T>(v);
+        }
+    }
+    static void write(std::string &out,T v){
+        if constexpr(is_bound_enum<T>::value){
+            for(const auto &entry:enum_values<T>::value){
+                if(entry.second==v){
+                    write_string(out,entry.first);
+                    return;
+                }
+            }
+        }
+        codec<underlying>::write(out,static_cast<underlying>(v));
+    }
+};
+
+template<typename T>
+struct codec<T,std::enable_if_t<is_bound<T>::value>> {
+    using tuple=std::decay_t<decltype(fields<T>::value)>;
+    static constexpr size_t count=std::tuple_size_v<tuple>;
+    template<size_t I>
+    using member_type=typename std::tuple_element_t<I,tuple>::member_type;
+    using reader=void(*)(JSON_Lexer*,T&);
+
+    template<size_t... I>
+    static constexpr std::array<std::string_view,count> make_names(std::index_sequence<I...>){
+        return {{std::get<I>(fields<T>::value).name...}};
+    }
+    static constexpr std::array<std::string_view,count> names=make_names(std::make_index_sequence<count>());
+    static constexpr key_table<count> table=make_key_table<count>(names);
+    static_assert(table.found,"JSON_BIND field names must be unique");
+
+    template<size_t I>
+    static void read_field(JSON_Lexer * p,T &out){
+        codec<member_type<I>>::read(p,out.*(std::get<I>(fields<T>::value).member));
+    }
+    template<size_t... I>
+    static constexpr std::array<reader,count> make_readers(std::index_sequence<I...>){
+        return {{&read_field<I>...}};
+    }
+    static constexpr std::array<reader,count> readers=make_readers(std::make_index_sequence<count>());
+
+    static int find(std::string_view key){
+        int i=table.slots[key_hash(key,table.seed,table.full)&(table.size-1)];
+        return i>=0&&names[i]==key?i:-1;
+    }
+
+    static void read(JSON_Lexer * p,T &out){
+        if(!begin(p,'{','}'))return;
+        std::string buf;
+        do{
+            std::string_view key=read_key(p,buf);
+            expect(p,':');
+            int i=find(key);
+            if(i>=0){
+                readers[i](p,out);
+            }else{
+                check(p,json_lex_skip(p));
+            }
+        }while(next(p,'}'));
+    }
+
+    template<size_t I>
+    static void write_field(std::string &out,const T &v,bool &first){
+        //empty optionals are left out
+        const member_type<I> &m=v.*(std::get<I>(fields<T>::value).member);
+        if constexpr(is_optional<member_type<I>>::value){
+            if(!m)return;
+        }
+        if(!first)out+=',';
+        first=false;
+        write_string(out,names[I]);
+        out+=':';
+        codec<member_type<I>>::write(out,m);
+    }
+    template<size_t... I>
+    static void write_fields(std::string &out,const T &v,std::index_sequence<I...>){
+        bool first=true;
+        (write_field<I>(out,v,first),...);
+    }
+    static void write(std::string &out,const T &v){
+        out+='{';
+        write_fields(out,v,std::make_index_sequence<count>());
+        out+='}';
+    }
+};
+
+}
+
+template<typename T>
+void parse_into(std::string_view s,T &out){
+    JSON_Lexer p={0,s.size(),s.data(),0,{}};
+    bind::codec<T>::read(&p,out);
+}
+
+template<typename T>
+T parse_as(std::string_view s){
+    T out{};
+    parse_into(s,out);
+    return out;
+}
+
+template<typename T>
+void to_json(std::string &out,const T &v){//appends to out, compact
+    bind::codec<T>::write(out,v);
+}
+
+template<typename T>
+std::string to_json(const T &v){
+    std::string out;
+    to_json(out,v);
+    return out;
+}
+
+}
+
+#define JSON_BIND_FIELD(T,m) ::json::bind::make_field(#m,&T::m)
+
+#define JSON_BIND(T,...) \
+    template<> \
+    struct json::bind::fields<T> { \
+        static constexpr auto value=std::make_tuple(JSON_BIND_EACH(JSON_BIND_FIELD,T,__VA_ARGS__)); \
+    };
+
+#define JSON_BIND_ENUM_VALUE(T,v) std::pair<std::string_view,T>(#v,T::v)
+
+#define JSON_BIND_ENUM(T,...) \
+    template<> \
+    struct json::bind::enum_values<T> { \
+        static constexpr std::pair<std::string_view,T> value[]={JSON_BIND_EACH(JSON_BIND_ENUM_VALUE,T,__VA_ARGS__)}; \
+    };
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif // __cplusplus
+
+#include <stdio.h>
+
+//push-style writer, emits JSON as it's generated without building a tree
+//
+//calls are checked against the structure of the document: keys only inside objects, a value after every key, ends matching their begins,
+//a single top-level value; the first misplaced call (or sink failure) stops the generator, every later call returns false and writes nothing
+//with a sink, output is flushed in chunks as it's generated, so memory only depends on the nesting depth
+//without one, the whole output is kept in memory, see json_gen_buffer
+
+#define JSON_GEN_PRETTY 0x1//same layout as json_write_element, otherwise no whitespace at all
+
+typedef enum JSON_Gen_Error {
+    JSON_GEN_OK,
+    JSON_GEN_MISPLACED,//call not allowed at this point of the document, or json_gen_finish on an incomplete document
+    JSON_GEN_INVALID_NUMBER,//nan or infinity
+    JSON_GEN_SINK_FAILED,
+} JSON_Gen_Error;
+
+typedef bool (*JSON_Gen_Sink)(void * ctx,const char * data,size_t n);//must write all n bytes, returns false on failure
+
+bool json_gen_file_sink(void * f,const char * data,size_t n);//sink for a FILE*, pass it as ctx
+
+typedef struct JSON_Gen JSON_Gen;
+
+JSON_Gen * json_make_gen(uint32_t flags,JSON_Gen_Sink sink,void * ctx);//sink may be NULL to generate into memory
+
+void json_free_gen(JSON_Gen * gen);
+
+JSON_Gen_Error json_gen_error(const JSON_Gen * gen);
+
+bool json_gen_begin_object(JSON_Gen * gen);
+bool json_gen_end_object(JSON_Gen * gen);
+bool json_gen_begin_array(JSON_Gen * gen);
+bool json_gen_end_array(JSON_Gen * gen);
+
+bool json_gen_key(JSON_Gen * gen,const char * key);
+bool json_gen_key_n(JSON_Gen * gen,const char * key,size_t n);
+
+bool json_gen_null(JSON_Gen * gen);
+bool json_gen_bool(JSON_Gen * gen,bool b);
+bool json_gen_int(JSON_Gen * gen,int64_t i);
+bool json_gen_double(JSON_Gen * gen,double d);//same format as json_write_element
+bool json_gen_string(JSON_Gen * gen,const char * s);
+bool json_gen_string_n(JSON_Gen * gen,const char * s,size_t n);//s doesn't need to be null-terminated
+
+bool json_gen_element(JSON_Gen * gen,JSON_Element * elem);//writes a whole tree as one value
+
+bool json_gen_finish(JSON_Gen * gen);//checks the document is complete and flushes it to the sink
+
+const char * json_gen_buffer(const JSON_Gen * gen,size_t * len);//output generated so far when there's no sink, not null-terminated
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif // __cplusplus
+
+//tokenizer used by json_parse_n, and by every other parser built on top of the same grammar
+//functions return false (or NULL) on failure and record the error in p->error, nothing is allocated for it
+
+typedef struct JSON_Lexer {
+    size_t i;//current position
+    size_t n;
+    const char * s;
+    uint32_t flags;//JSON_PARSE_* flags
+    JSON_Error error;//set by the function that failed
+} JSON_Lexer;
+
+typedef union JSON_Number {
+    double d;
+    int64_t i;
+} JSON_Number;
+
+void json_lex_whitespace(JSON_Lexer * p);//skips whitespace and comments
+
+bool json_lex_unexpected(JSON_Lexer * p,const char * expected);//records a JSON_ERROR_UNEXPECTED at p->i, expected must be a static string, always returns false
+
+bool json_lex_string_length(JSON_Lexer * p,size_t * len);//skips whitespace and validates the string at p->i, sets len to its unescaped length, doesn't consume it
+
+void json_lex_string_copy(JSON_Lexer * p,char * out);//consumes a string validated by json_lex_string_length, writing its unescaped contents to out (not null-terminated), or just skipping it if out is NULL
+
+bool json_lex_number(JSON_Lexer * p,JSON_Number * number,bool * is_double);
+
+JSON_Element_Type json_lex_literal(JSON_Lexer * p);//consumes true/false/null, returns JSON_PARSE_ERROR without consuming anything if there's no literal at p->i
+
+bool json_lex_skip(JSON_Lexer * p);//consumes a whole element without building it
+
+JSON_Element * json_parse_element(JSON_Lexer * p);//parses the element at p->i into a tree, returns NULL on failure
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
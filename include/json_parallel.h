@@ -0,0 +1,31 @@
+#pragma once
+
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif // __cplusplus
+
+#include <stdio.h>
+
+//parallel writer for large documents, output is byte-identical to json_write_element
+//
+//large arrays and objects are split into chunks of consecutive items, which are serialized into separate buffers by a pool of worker threads
+//and written out in order as they complete, only a bounded window of chunks is held in memory at a time
+//the tree must not be modified while it's being written, one pool writes one document at a time
+
+typedef struct JSON_Write_Pool JSON_Write_Pool;
+
+JSON_Write_Pool * json_make_write_pool(size_t threads);//threads may be 0 for one per online cpu
+
+void json_free_write_pool(JSON_Write_Pool * pool);
+
+bool json_write_element_parallel(JSON_Write_Pool * pool,FILE * f,JSON_Element * elem,size_t indentation);//returns false if writing to f failed
+
+bool json_write_element_fd(JSON_Write_Pool * pool,int fd,JSON_Element * elem,size_t indentation);//writes with writev, returns false and leaves errno set if a write failed
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+//reusable parser for parsing many small documents on one thread
+//
+//documents are built in an arena owned by the parser, and stay valid until the next parse, json_parser_reset or json_free_parser
+//they are read-only: don't modify or free them, use json_clone to get an independent copy
+//the arena, container stack, string scratch and interned keys are kept between parses, up to the limits
+
+typedef struct JSON_Parser JSON_Parser;
+
+typedef struct JSON_Parser_Limits {
+    size_t arena;//bytes of arena chunks kept by json_parser_reset
+    size_t scratch;//bytes of container stack and key scratch kept after a parse
+    size_t keys;//bytes of interned keys, keys past this are copied into the arena instead
+} JSON_Parser_Limits;
+
+JSON_Parser * json_make_parser(const JSON_Parser_Limits * limits);//limits may be NULL for the defaults: 1MB arena, 256KB scratch, 64KB keys
+
+void json_free_parser(JSON_Parser * parser);
+
+JSON_Element * json_parser_parse_n(JSON_Parser * parser,const char * s,size_t n,uint32_t flags,JSON_Error * error);//same as json_try_parse_n, releases the previous document first
+
+JSON_Element * json_parser_parse(JSON_Parser * parser,const char * s,uint32_t flags,JSON_Error * error);
+
+void json_parser_reset(JSON_Parser * parser);//releases the last document, and trims retained arena chunks down to the limit
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
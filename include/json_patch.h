@@ -0,0 +1,20 @@
+#pragma once
+
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+//patches are applied to target in place, their values are cloned into target, which shares their arrays and objects instead of copying them (see json_clone),
+//so applying a patch only costs time proportional to the patch and the paths it changes, not to the target, and the patch itself is never modified
+
+void json_merge_patch(JSON_Element * target,JSON_Element * patch);//RFC 7386 JSON Merge Patch, patch pointer is invalidated
+
+int json_patch_apply(JSON_Element * target,JSON_Element * patch);//RFC 6902 JSON Patch, patch pointer is invalidated, returns 1 if an operation is invalid or fails, target is left with the operations before it applied
+
+JSON_Element * json_diff(JSON_Element * from,JSON_Element * to);//returns a RFC 6902 JSON Patch array that turns from into to
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+//RFC 6901 JSON Pointer lookups ("/request/headers/0", '~0' escapes '~', '~1' escapes '/', "" is the whole document)
+//lookups only read, same as json_array_item an item of a packed array is copied into tmp, which is returned
+
+JSON_Element * json_pointer_get(JSON_Element * root,const char * pointer,JSON_Element * tmp);//returns NULL if not found or if pointer is invalid, pointers returned from this are 'fragile'
+JSON_Element * json_pointer_get_n(JSON_Element * root,const char * pointer,size_t n,JSON_Element * tmp);
+
+JSON_Element * json_pointer_get_mut(JSON_Element * root,const char * pointer);//same lookup with json_object_get_mut/json_array_get_mut, unshares the path for modifying the result in place
+JSON_Element * json_pointer_get_mut_n(JSON_Element * root,const char * pointer,size_t n);
+
+//compiled pointers, segments are unescaped and their hashes, lengths and array indices are computed once, so they can be evaluated repeatedly against different documents
+
+typedef struct JSON_Path JSON_Path;
+
+JSON_Path * json_path_compile(const char * pointer);//returns NULL if pointer is invalid
+JSON_Path * json_path_compile_n(const char * pointer,size_t n);
+
+void json_path_free(JSON_Path * path);
+
+JSON_Element * json_path_eval(const JSON_Path * path,JSON_Element * root,JSON_Element * tmp);//returns NULL if not found, pointers returned from this are 'fragile'
+
+//batches of compiled pointers, shared prefixes are resolved once per evaluation
+
+typedef struct JSON_Path_Batch JSON_Path_Batch;
+
+JSON_Path_Batch * json_path_batch_compile(const char * const * pointers,size_t count);//returns NULL if any of the pointers is invalid
+
+void json_path_batch_free(JSON_Path_Batch * batch);
+
+void json_path_batch_eval(const JSON_Path_Batch * batch,JSON_Element * root,JSON_Element ** results,JSON_Element * tmp);//results[i] is set to the element for pointers[i], or NULL if not found, tmp holds one element per pointer for packed items
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+//JSON Schema subset compiled into a flat validation program, that can be checked while parsing
+//supported keywords: type, required, properties, additionalProperties, items, enum, minimum, maximum, maxLength
+//other keywords are ignored
+
+typedef struct JSON_Schema JSON_Schema;
+
+JSON_Schema * json_schema_compile(JSON_Element * schema,JSON_Element ** error);//on failure returns NULL and, if error isn't NULL, sets it to a JSON_PARSE_ERROR element
+
+void json_schema_free(JSON_Schema * schema);
+
+//validation errors are JSON_PARSE_ERROR elements, with the JSON Pointer of the offending value in the message
+//parsing stops at the first violation
+
+JSON_Element * json_parse_validated_n(const char * s,size_t n,const JSON_Schema * schema);//same as json_parse_n, but fails if the document doesn't match the schema
+
+JSON_Element * json_parse_validated(const char * s,const JSON_Schema * schema);
+
+JSON_Element * json_validate_n(const char * s,size_t n,const JSON_Schema * schema);//checks a document without building a tree, returns NULL if it's valid, or an error element
+
+JSON_Element * json_validate(const char * s,const JSON_Schema * schema);
+
+JSON_Element * json_schema_validate(const JSON_Schema * schema,JSON_Element * elem);//checks an already parsed tree, returns NULL if it's valid, or an error element
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
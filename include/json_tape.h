@@ -0,0 +1,62 @@
+#pragma once
+
+#include "json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+//read-only flat representation of a document: one contiguous tape of 64-bit words plus one string buffer
+//
+//every word is (tag<<56)|payload, elements are addressed by their index in the tape
+//  array/object start : payload is the index of the matching end word in the low 32 bits, entry count in the high 24 bits (saturated)
+//  array/object end   : payload is the index of the matching start word
+//  string             : payload is the offset of the string in the string buffer, stored as u32 length, bytes, '\0'
+//  integer/double     : followed by one word holding the raw int64_t/double
+//  true/false/null    : tag only
+//object entries are stored as a string word (the key) followed by the value
+
+typedef struct JSON_Tape {
+    uint64_t * tape;
+    size_t size;
+    char * strings;
+    size_t strings_size;
+} JSON_Tape;
+
+JSON_Tape * json_parse_tape_n(const char * s,size_t n,JSON_Element ** error);//on failure returns NULL and, if error isn't NULL, sets it to a JSON_PARSE_ERROR element
+
+JSON_Tape * json_parse_tape(const char * s,JSON_Element ** error);
+
+void json_free_tape(JSON_Tape * tape);
+
+JSON_Element_Type json_tape_type(const JSON_Tape * tape,size_t i);
+
+int64_t json_tape_integer(const JSON_Tape * tape,size_t i);
+
+double json_tape_double(const JSON_Tape * tape,size_t i);
+
+const char * json_tape_string(const JSON_Tape * tape,size_t i,size_t * len);//returned pointer points into the string buffer, is null-terminated
+
+size_t json_tape_size(const JSON_Tape * tape,size_t i);//number of entries in an array or object
+
+//array iteration: for(size_t c=json_tape_child(i);c<json_tape_end(t,i);c=json_tape_next(t,c))
+//object iteration: for(size_t c=json_tape_child(i);c<json_tape_end(t,i);c=json_tape_next(t,c+1)), keys are at c, values at c+1
+
+size_t json_tape_child(size_t i);//index of the first entry of a container
+
+size_t json_tape_end(const JSON_Tape * tape,size_t i);//index of the closing word of a container
+
+size_t json_tape_next(const JSON_Tape * tape,size_t i);//index of the element after i, skipping over its contents
+
+size_t json_tape_array_get(const JSON_Tape * tape,size_t arr,size_t index);//returns 0 if not found (0 is always the root)
+
+size_t json_tape_object_get(const JSON_Tape * tape,size_t obj,const char * key);//returns 0 if not found
+size_t json_tape_object_get_n(const JSON_Tape * tape,size_t obj,const char * key,size_t n);//returns 0 if not found
+
+JSON_Element * json_tape_to_element(const JSON_Tape * tape,size_t i);
+
+JSON_Tape * json_tape_from_element(JSON_Element * elem);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
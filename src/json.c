@@ -1,4 +1,5 @@
 #include "json.h"
+#include "json_internal.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
@@ -7,29 +8,20 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdarg.h>
-
-#define OOM_EXIT() err_exit("Out of Memory in %s",__func__)
-
-static void json_cleanup_element(void * p);
-
-typedef struct JSON_Object_Table_Elem {
-    uint32_t size;
-    uint32_t alloc;
-    void * arr;
-} JSON_Object_Table_Elem;
-
-typedef struct JSON_Object_Table {
-    uint32_t num_buckets;
-    uint32_t item_size;
-    JSON_Object_Table_Elem buckets[];
-} JSON_Object_Table;
+#include <limits.h>
 
 typedef JSON_Object_Table table;
 typedef JSON_Object_Table_Elem table_elem;
 
+typedef char element_size_check[sizeof(JSON_Element)==16?1:-1];//the 16 byte layout in json.h, inline strings rely on the type bits sharing byte 0
+
 static table * alloc_table(size_t num_buckets,size_t item_size){
     table * tbl=calloc(1,sizeof(table)+
                          (num_buckets*sizeof(table_elem)));
+    if(!tbl){
+        OOM_EXIT();
+    }
+    tbl->refs=1;
     tbl->num_buckets=num_buckets;
     tbl->item_size=item_size;
     return tbl;
@@ -67,8 +59,8 @@ static void table_add_item(table * tbl,void * item,uint32_t (*hash)(void*)){
     memcpy((uint8_t*)e->arr+((e->size++)*tbl->item_size),item,tbl->item_size);
 }
 
-static void * table_find_item(table * tbl,void * key,uint32_t (*hash)(void*),int (*compare)(void*,void*)){
-    table_elem * e=&tbl->buckets[hash(key)%tbl->num_buckets];
+static void * table_find_item_hashed(table * tbl,void * key,uint32_t hash,int (*compare)(void*,void*)){
+    table_elem * e=&tbl->buckets[hash%tbl->num_buckets];
     if(!(e->arr&&e->size)) return NULL;
     uint8_t * arr=e->arr;
     uint32_t isz=tbl->item_size;
@@ -81,32 +73,59 @@ static void * table_find_item(table * tbl,void * key,uint32_t (*hash)(void*),int
     return NULL;
 }
 
-typedef struct JSON_ObjectEntry {
-    char * key;
-    JSON_Element elem;
-} JSON_ObjectEntry;
+static bool table_remove_item_hashed(table * tbl,void * key,uint32_t hash,int (*compare)(void*,void*),void (*cleanup)(void*)){
+    table_elem * e=&tbl->buckets[hash%tbl->num_buckets];
+    uint8_t * item=table_find_item_hashed(tbl,key,hash,compare);
+    if(!item)return false;
+    if(cleanup) cleanup(item);
+    uint8_t * end=(uint8_t*)e->arr+(e->size*tbl->item_size);
+    memmove(item,item+tbl->item_size,end-(item+tbl->item_size));
+    --e->size;
+    return true;
+}
 
 JSON_Object * json_make_object(){
     JSON_Object * obj=&((JSON_Element*)calloc(1,sizeof(JSON_Element)))->_obj;
-    obj->type=JSON_OBJECT;
-    obj->tbl=alloc_table(32,sizeof(JSON_ObjectEntry));
+    json_init_object(obj);
     return obj;
 }
 
-static int json_object_find_compare_keys(void * item,void * key){
-    return strcmp(((JSON_ObjectEntry*)item)->key,(const char *)key)==0;
+void json_init_object(JSON_Object * obj){
+    obj->type=JSON_OBJECT;
+    obj->tbl=alloc_table(JSON_OBJECT_BUCKETS,sizeof(JSON_ObjectEntry));
 }
 
 static uint32_t json_object_item_hash(void * item){
     return str_hash(((JSON_ObjectEntry*)item)->key);
 }
 
-static uint32_t json_object_key_hash(void * key){
-    return str_hash((const char *)key);
+uint32_t json_key_hash(const char * key){
+    return str_hash(key);
 }
 
-JSON_Element * json_object_get_n(JSON_Object * obj,const char * key,size_t n){
-    JSON_ObjectEntry * entry=table_find_item(obj->tbl,(void*)key,json_object_key_hash,json_object_find_compare_keys);
+uint32_t json_key_hash_n(const char * key,size_t n){
+    //same as str_hash, but bounded by n, keys passed with a length aren't necessarily terminated
+    size_t hash=5381;
+    for(size_t i=0;i<n&&key[i];i++){
+        hash=((hash<<5)+hash)+((size_t)(unsigned char)key[i]);
+    }
+    return hash;
+}
+
+typedef struct sized_key {
+    const char * key;
+    size_t n;
+} sized_key;
+
+static int json_object_find_compare_sized_keys(void * item,void * key){
+    JSON_ObjectEntry * entry=item;
+    sized_key * sk=key;
+    return entry->len==sk->n&&memcmp(entry->key,sk->key,sk->n)==0;
+}
+
+JSON_Element * json_object_get_hashed(JSON_Object * obj,const char * key,size_t n,uint32_t hash){
+    sized_key sk={.key=key,.n=n};
+    JSON_ObjectEntry * entry=table_find_item_hashed(obj->tbl,&sk,hash,json_object_find_compare_sized_keys);
     if(entry){
         return &entry->elem;
     }else{
@@ -114,24 +133,56 @@ JSON_Element * json_object_get_n(JSON_Object * obj,const char * key,size_t n){
     }
 }
 
+JSON_Element * json_object_get_n(JSON_Object * obj,const char * key,size_t n){
+    return json_object_get_hashed(obj,key,n,json_key_hash_n(key,n));
+}
+
 JSON_Element * json_object_get(JSON_Object * obj,const char * key){
-    return json_object_get_n(obj,key,strlen(key));
+    return json_object_get_hashed(obj,key,strlen(key),json_key_hash(key));
 }
 
-void json_object_set_n(JSON_Object * obj,const char * key,size_t n,JSON_Element * elem){
-    JSON_ObjectEntry * entry=table_find_item(obj->tbl,(void*)key,json_object_key_hash,json_object_find_compare_keys);
+static void json_object_unshare(JSON_Object * obj);
+
+JSON_Element * json_object_get_mut_n(JSON_Object * obj,const char * key,size_t n){
+    json_object_unshare(obj);
+    return json_object_get_n(obj,key,n);
+}
+
+JSON_Element * json_object_get_mut(JSON_Object * obj,const char * key){
+    return json_object_get_mut_n(obj,key,strlen(key));
+}
+
+JSON_Element * json_object_emplace_n(JSON_Object * obj,const char * key,size_t n){
+    json_object_unshare(obj);
+    sized_key sk={.key=key,.n=n};
+    uint32_t hash=json_key_hash_n(key,n);
+    JSON_ObjectEntry * entry=table_find_item_hashed(obj->tbl,&sk,hash,json_object_find_compare_sized_keys);
     if(entry){
         json_cleanup_element(&entry->elem);
-        memcpy(&entry->elem,elem,sizeof(JSON_Element));
     }else{
         JSON_ObjectEntry new_entry = {
             .key=calloc(n+1,sizeof(char)),
+            .len=n,
             .elem={{0}},
         };
+        if(!new_entry.key){
+            OOM_EXIT();
+        }
         memcpy(new_entry.key,key,n);
-        memcpy(&new_entry.elem,elem,sizeof(JSON_Element));
         table_add_item(obj->tbl,&new_entry,json_object_item_hash);
+        entry=table_find_item_hashed(obj->tbl,&sk,hash,json_object_find_compare_sized_keys);
     }
+    memset(&entry->elem,0,sizeof(JSON_Element));
+    entry->elem.type=JSON_NULL;
+    return &entry->elem;
+}
+
+JSON_Element * json_object_emplace(JSON_Object * obj,const char * key){
+    return json_object_emplace_n(obj,key,strlen(key));
+}
+
+void json_object_set_n(JSON_Object * obj,const char * key,size_t n,JSON_Element * elem){
+    memcpy(json_object_emplace_n(obj,key,n),elem,sizeof(JSON_Element));
     free(elem);
 }
 
@@ -139,9 +190,62 @@ void json_object_set(JSON_Object * obj,const char * key,JSON_Element * elem){
     json_object_set_n(obj,key,strlen(key),elem);
 }
 
+static void json_cleanup_object_entry(void * p);
+
+int json_object_remove_n(JSON_Object * obj,const char * key,size_t n){
+    json_object_unshare(obj);
+    sized_key sk={.key=key,.n=n};
+    return table_remove_item_hashed(obj->tbl,&sk,json_key_hash_n(key,n),json_object_find_compare_sized_keys,json_cleanup_object_entry)?0:1;
+}
+
+int json_object_remove(JSON_Object * obj,const char * key){
+    return json_object_remove_n(obj,key,strlen(key));
+}
+
+JSON_Element * json_object_take_n(JSON_Object * obj,const char * key,size_t n){
+    JSON_Element * elem=json_object_get_mut_n(obj,key,n);
+    if(!elem)return NULL;
+    elem=json_take(elem);
+    json_object_remove_n(obj,key,n);
+    return elem;
+}
+
+size_t json_object_size(JSON_Object * obj){
+    size_t n=0;
+    for(uint32_t i=0;i<obj->tbl->num_buckets;i++){
+        n+=obj->tbl->buckets[i].size;
+    }
+    return n;
+}
+
+int json_object_next_n(JSON_Object * obj,JSON_Object_Iterator * it,const char ** key,size_t * key_len,JSON_Element ** elem){
+    for(;it->bucket<obj->tbl->num_buckets;it->bucket++,it->index=0){
+        table_elem * e=&obj->tbl->buckets[it->bucket];
+        if(e->arr&&it->index<e->size){
+            JSON_ObjectEntry * entry=&((JSON_ObjectEntry*)e->arr)[it->index++];
+            if(key) *key=entry->key;
+            if(key_len) *key_len=entry->len;
+            if(elem) *elem=&entry->elem;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int json_object_next(JSON_Object * obj,JSON_Object_Iterator * it,const char ** key,JSON_Element ** elem){
+    return json_object_next_n(obj,it,key,NULL,elem);
+}
+
+static void json_cleanup_object_entry(void * p){
+    JSON_ObjectEntry * entry=p;
+    free(entry->key);
+    json_cleanup_element(&entry->elem);
+}
+
 static void json_cleanup_object(JSON_Object * obj){
     if(!obj)return;
-    table_cleanup(obj->tbl,json_cleanup_element);
+    if(!json_ref_release(&obj->tbl->refs))return;//still used by a copy
+    table_cleanup(obj->tbl,json_cleanup_object_entry);
 }
 
 void json_free_object(JSON_Object * obj){
@@ -152,18 +256,43 @@ void json_free_object(JSON_Object * obj){
 
 JSON_Array * json_make_array(){
     JSON_Array * arr=&((JSON_Element*)calloc(1,sizeof(JSON_Element)))->_arr;
-    arr->type=JSON_ARRAY;
+    json_init_array(arr);
     return arr;
 }
 
+void json_init_array(JSON_Array * arr){
+    arr->type=JSON_ARRAY;
+    arr->packed=0;
+    arr->size=0;
+    arr->arr=NULL;
+}
+
+//(re)allocates the block of an unshared array for capacity items of item_size bytes, elements or packed values
+static void array_realloc(JSON_Array * arr,size_t capacity,size_t item_size){
+    size_t * block=realloc(arr->arr?json_array_block(arr):NULL,JSON_ARRAY_HEADER*sizeof(size_t)+capacity*item_size);
+    if(!block){
+        OOM_EXIT();
+    }
+    block[0]=1;
+    block[1]=capacity;
+    arr->arr=(JSON_Element*)(block+JSON_ARRAY_HEADER);
+}
+
+JSON_Element * json_array_alloc(size_t capacity){
+    JSON_Array arr={.arr=NULL};
+    array_realloc(&arr,capacity,sizeof(JSON_Element));
+    return arr.arr;
+}
+
 static void json_cleanup_array(JSON_Array * arr){
     if(!arr)return;
     if(arr->arr){
-        size_t sz=arr->size;
+        if(!json_ref_release(json_array_block(arr)))return;//still used by a copy
+        size_t sz=arr->packed?0:arr->size;
         for(size_t i=0;i<sz;i++){
             json_cleanup_element(&arr->arr[i]);
         }
-        free(arr->arr);
+        free(json_array_block(arr));
     }
 }
 
@@ -174,42 +303,75 @@ void json_free_array(JSON_Array * arr){
 }
 
 JSON_Element * json_array_get(JSON_Array * arr,size_t index){
-    if(index>arr->size){
+    if(index>=arr->size||arr->packed){//read-only, packed items have no element to point to
+        return NULL;
+    }
+    return arr->arr+index;
+}
+
+JSON_Element * json_array_item(JSON_Array * arr,size_t index,JSON_Element * tmp){
+    if(index>=arr->size){
+        return NULL;
+    }
+    if(!arr->packed)return arr->arr+index;
+    memset(tmp,0,sizeof(JSON_Element));
+    if(arr->packed==JSON_INTEGER){
+        tmp->_int.type=JSON_INTEGER;
+        tmp->_int.i=arr->ints[index];
+    }else{
+        tmp->_double.type=JSON_DOUBLE;
+        tmp->_double.d=arr->doubles[index];
+    }
+    return tmp;
+}
+
+static void json_array_unshare(JSON_Array * arr);
+
+JSON_Element * json_array_get_mut(JSON_Array * arr,size_t index){
+    if(index>=arr->size){
         return NULL;
     }
+    json_array_unpack(arr);
+    json_array_unshare(arr);
     return arr->arr+index;
 }
 
 void json_array_set(JSON_Array * arr,JSON_Element * elem,size_t index){
-    if(index>arr->size)return;
+    if(index>=arr->size)return;
+    json_array_unpack(arr);
+    json_array_unshare(arr);
     json_cleanup_element(arr->arr+index);
     memcpy(arr->arr+index,elem,sizeof(JSON_Element));
     free(elem);
 }
 
 static void json_array_grow_by(JSON_Array * arr,size_t by){
-    if(arr->alloc>=(arr->size+by))return;
-    if(arr->arr){
-        arr->arr=realloc(arr->arr,(arr->size+by)*sizeof(JSON_Element));
-    }else{
-        arr->arr=calloc(by,sizeof(JSON_Element));
-    }
-    if(!arr->arr){
-        OOM_EXIT();
-    }
+    json_array_unpack(arr);
+    json_array_unshare(arr);
+    size_t alloc=json_array_capacity(arr);
+    if(alloc>=(arr->size+by))return;
+    size_t new_alloc=alloc?alloc*2:4;//growth factor 2
+    if(new_alloc<arr->size+by)new_alloc=arr->size+by;
+    array_realloc(arr,new_alloc,sizeof(JSON_Element));
 }
 
-void json_array_push(JSON_Array * arr,JSON_Element * elem){
+JSON_Element * json_array_emplace(JSON_Array * arr){
     json_array_grow_by(arr,1);
-    memcpy(arr->arr+arr->size,elem,sizeof(JSON_Element));
-    ++arr->size;
+    JSON_Element * elem=arr->arr+arr->size++;
+    memset(elem,0,sizeof(JSON_Element));
+    elem->type=JSON_NULL;
+    return elem;
+}
+
+void json_array_push(JSON_Array * arr,JSON_Element * elem){
+    memcpy(json_array_emplace(arr),elem,sizeof(JSON_Element));
     free(elem);
 }
 
 int json_array_insert(JSON_Array * arr,JSON_Element * elem,size_t index){
     if(arr->size>index){
         json_array_grow_by(arr,1);
-        memmove(arr->arr+index+1,arr->arr+index,((arr->size-index)-1)*sizeof(JSON_Element));
+        memmove(arr->arr+index+1,arr->arr+index,(arr->size-index)*sizeof(JSON_Element));
         ++arr->size;
         memcpy(arr->arr+index,elem,sizeof(JSON_Element));
         free(elem);
@@ -227,32 +389,111 @@ int json_array_insert(JSON_Array * arr,JSON_Element * elem,size_t index){
 
 void json_array_remove(JSON_Array * arr,size_t index){
     if(arr->size>index){
+        json_array_unpack(arr);
+        json_array_unshare(arr);
         json_cleanup_element(arr->arr+index);
         --arr->size;
         if(arr->size>index) memmove(arr->arr+index,arr->arr+index+1,(arr->size-index)*sizeof(JSON_Element));
     }
 }
 
+double * json_array_as_doubles(JSON_Array * arr){
+    return arr->packed==JSON_DOUBLE?arr->doubles:NULL;
+}
+
+int64_t * json_array_as_ints(JSON_Array * arr){
+    return arr->packed==JSON_INTEGER?arr->ints:NULL;
+}
+
+//moves count 8-byte values to the front of the block and shrinks it, values[i] is read from the element at i before anything at or after it is written
+static void pack_block(JSON_Array * arr,JSON_Element_Type type){
+    size_t n=arr->size;
+    char * values=(char*)arr->arr;
+    for(size_t i=0;i<n;i++){
+        JSON_Number v;
+        if(type==JSON_INTEGER){
+            v.i=arr->arr[i]._int.i;
+        }else{
+            v.d=arr->arr[i]._double.d;
+        }
+        memcpy(values+i*sizeof(JSON_Number),&v,sizeof(JSON_Number));
+    }
+    array_realloc(arr,n,sizeof(JSON_Number));
+    arr->packed=type;
+}
+
+int json_array_pack(JSON_Array * arr){
+    if(arr->packed)return 1;
+    if(!arr->size)return 0;
+    JSON_Element_Type type=arr->arr[0].type;
+    if(type!=JSON_INTEGER&&type!=JSON_DOUBLE)return 0;
+    for(size_t i=1;i<arr->size;i++){
+        if(arr->arr[i].type!=type)return 0;
+    }
+    json_array_unshare(arr);
+    pack_block(arr,type);
+    return 1;
+}
+
+void json_array_unpack(JSON_Array * arr){
+    if(!arr->packed)return;
+    JSON_Element * a=json_array_alloc(arr->size);
+    for(size_t i=0;i<arr->size;i++){
+        json_array_item(arr,i,&a[i]);
+    }
+    JSON_Array old=*arr;
+    arr->arr=a;
+    arr->packed=0;
+    json_cleanup_array(&old);
+}
+
+JSON_Element * json_array_take(JSON_Array * arr,size_t index){
+    if(index>=arr->size)return NULL;
+    json_array_unpack(arr);
+    json_array_unshare(arr);
+    JSON_Element * elem=json_take(arr->arr+index);
+    json_array_remove(arr,index);
+    return elem;
+}
+
 JSON_String * json_make_string_n(const char * s,size_t n){
     JSON_String * str=&((JSON_Element*)calloc(1,sizeof(JSON_Element)))->_str;
-    str->type=JSON_STRING;
-    str->str=calloc(n+1,sizeof(char));
-    memcpy(str->str,s,n);
-    str->str[n]=0;
-    str->len=n;
+    json_init_string_n(str,s,n);
     return str;
 }
 
+char * json_init_string_buffer(JSON_String * str,size_t n){
+    memset(str,0,sizeof(JSON_String));
+    str->type=JSON_STRING;
+    char * buf;
+    if(n<=JSON_STRING_INLINE_MAX){
+        //short strings live in the element itself, the rest of it is zeroed so it's already terminated
+        str->small=n;
+        buf=(char*)str+1;
+    }else{
+        str->small=JSON_STRING_HEAP;
+        str->heap_len=n;
+        str->heap_str=buf=malloc(n+1);
+        if(!buf){
+            OOM_EXIT();
+        }
+        buf[n]=0;
+    }
+    return buf;
+}
+
+void json_init_string_n(JSON_String * str,const char * s,size_t n){
+    memcpy(json_init_string_buffer(str,n),s,n);
+}
+
 JSON_String * json_make_string(const char * s){
     return json_make_string_n(s,strlen(s));
 }
 
 void json_set_string_n(JSON_String * str,const char * s,size_t n){
-    free(str->str);
-    str->str=calloc(n+1,sizeof(char));
-    memcpy(str->str,s,n);
-    str->str[n]=0;
-    str->len=n;
+    char * old=str->small==JSON_STRING_HEAP?str->heap_str:NULL;//s may point into it
+    json_init_string_n(str,s,n);
+    free(old);
 }
 
 void json_set_string(JSON_String * str,const char * s){
@@ -261,12 +502,12 @@ void json_set_string(JSON_String * str,const char * s){
 
 void json_cleanup_string(JSON_String * str){
     if(!str)return;
-    free(str->str);
+    if(str->small==JSON_STRING_HEAP) free(str->heap_str);
 }
 
 void json_free_string(JSON_String * str){
     if(!str)return;
-    free(str->str);
+    json_cleanup_string(str);
     free(str);
 }
 
@@ -285,19 +526,18 @@ JSON_Double * json_make_double(double d){
     return de;
 }
 
-static void json_cleanup_element(void * p){
-    if(!p)return;
-    JSON_Element * elem=p;
+void json_cleanup_element(JSON_Element * elem){
+    if(!elem)return;
     switch(elem->type){
     case JSON_ARRAY:
-        json_cleanup_array(p);
+        json_cleanup_array(&elem->_arr);
         break;
     case JSON_OBJECT:
-        json_cleanup_object(p);
+        json_cleanup_object(&elem->_obj);
         break;
     case JSON_PARSE_ERROR:
     case JSON_STRING:
-        json_cleanup_string(p);
+        json_cleanup_string(&elem->_str);
         break;
     default:
         break;
@@ -310,11 +550,323 @@ void json_free_element(JSON_Element * elem){
     free(elem);
 }
 
-typedef struct parse_data {
-    size_t i;
-    size_t n;
-    const char * s;
-} parse_data;
+JSON_Element * json_take(JSON_Element * elem){
+    JSON_Element * e=malloc(sizeof(JSON_Element));
+    if(!e){
+        OOM_EXIT();
+    }
+    memcpy(e,elem,sizeof(JSON_Element));
+    memset(elem,0,sizeof(JSON_Element));
+    elem->type=JSON_NULL;
+    return e;
+}
+
+void json_replace(JSON_Element * dst,JSON_Element * src){
+    json_cleanup_element(dst);
+    memcpy(dst,src,sizeof(JSON_Element));
+    free(src);
+}
+
+//clone/equal/hash walk the tree with an explicit stack, so deep documents can't overflow the call stack
+
+typedef struct walk_item {
+    JSON_Element * a;
+    JSON_Element * b;
+    uint64_t seed;
+} walk_item;
+
+typedef struct walk_stack {
+    walk_item * items;
+    size_t size;
+    size_t alloc;
+} walk_stack;
+
+static void walk_push(walk_stack * s,JSON_Element * a,JSON_Element * b,uint64_t seed){
+    if(s->size==s->alloc){
+        s->alloc=s->alloc?s->alloc*2:32;//growth factor 2
+        s->items=realloc(s->items,s->alloc*sizeof(walk_item));
+        if(!s->items){
+            OOM_EXIT();
+        }
+    }
+    s->items[s->size++]=(walk_item){.a=a,.b=b,.seed=seed};
+}
+
+static char * copy_key(const char * key,size_t n){
+    char * k=malloc(n+1);
+    if(!k){
+        OOM_EXIT();
+    }
+    memcpy(k,key,n+1);
+    return k;
+}
+
+//copies the items of src into a new block for dst, they're pushed to s to be cloned in turn
+static void copy_array(walk_stack * s,JSON_Array * src,JSON_Array * dst){
+    dst->arr=NULL;
+    if(src->packed){
+        array_realloc(dst,src->size,sizeof(JSON_Number));
+        memcpy(dst->ints,src->ints,src->size*sizeof(JSON_Number));
+    }else if(src->size){
+        dst->arr=json_array_alloc(src->size);
+        for(size_t i=0;i<src->size;i++){
+            walk_push(s,&src->arr[i],&dst->arr[i],0);
+        }
+    }
+}
+
+static table * copy_table(walk_stack * s,table * st){
+    //same bucket count and hash, so every bucket can be copied as-is with an exact-size allocation
+    table * dt=alloc_table(st->num_buckets,st->item_size);
+    for(uint32_t i=0;i<st->num_buckets;i++){
+        if(!st->buckets[i].arr||!st->buckets[i].size)continue;
+        uint32_t sz=st->buckets[i].size;
+        JSON_ObjectEntry * se=st->buckets[i].arr;
+        JSON_ObjectEntry * de=malloc(sz*sizeof(JSON_ObjectEntry));
+        if(!de){
+            OOM_EXIT();
+        }
+        dt->buckets[i].arr=de;
+        dt->buckets[i].size=sz;
+        dt->buckets[i].alloc=sz;
+        for(uint32_t j=0;j<sz;j++){
+            de[j].key=copy_key(se[j].key,se[j].len);
+            de[j].len=se[j].len;
+            walk_push(s,&se[j].elem,&de[j].elem,0);
+        }
+    }
+    return dt;
+}
+
+//counted arrays and objects are shared, only the ones of arena documents are copied
+static void clone_into(walk_stack * s,JSON_Element * src,JSON_Element * dst){
+    memcpy(dst,src,sizeof(JSON_Element));
+    switch(src->type){
+    case JSON_ARRAY:
+        if(src->_arr.arr&&!json_ref_acquire(json_array_block(&src->_arr))){
+            copy_array(s,&src->_arr,&dst->_arr);
+        }
+        break;
+    case JSON_OBJECT:
+        if(!json_ref_acquire(&src->_obj.tbl->refs)){
+            dst->_obj.tbl=copy_table(s,src->_obj.tbl);
+        }
+        break;
+    case JSON_PARSE_ERROR:
+    case JSON_STRING:
+        if(src->_str.small==JSON_STRING_HEAP){
+            dst->_str.heap_str=malloc(src->_str.heap_len+1);
+            if(!dst->_str.heap_str){
+                OOM_EXIT();
+            }
+            memcpy(dst->_str.heap_str,src->_str.heap_str,src->_str.heap_len+1);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void clone_walk(walk_stack * s){
+    while(s->size){
+        walk_item it=s->items[--s->size];
+        clone_into(s,it.a,it.b);
+    }
+    free(s->items);
+}
+
+JSON_Element * json_clone(JSON_Element * elem){
+    JSON_Element * root=malloc(sizeof(JSON_Element));
+    if(!root){
+        OOM_EXIT();
+    }
+    walk_stack s={0};
+    clone_into(&s,elem,root);
+    clone_walk(&s);
+    return root;
+}
+
+//copy on write, the container gets a block of its own where every item is cloned, so only this level is copied
+//the old block is released afterwards, it may have become unshared meanwhile if another copy was freed
+
+static void json_array_unshare(JSON_Array * arr){
+    if(!arr->arr||!json_ref_shared(json_array_block(arr)))return;
+    JSON_Array old=*arr;
+    walk_stack s={0};
+    copy_array(&s,&old,arr);
+    clone_walk(&s);
+    json_cleanup_array(&old);
+}
+
+static void json_object_unshare(JSON_Object * obj){
+    if(!json_ref_shared(&obj->tbl->refs))return;
+    JSON_Object old=*obj;
+    walk_stack s={0};
+    obj->tbl=copy_table(&s,old.tbl);
+    clone_walk(&s);
+    json_cleanup_object(&old);
+}
+
+int json_equal(JSON_Element * a,JSON_Element * b){
+    walk_stack s={0};
+    walk_push(&s,a,b,0);
+    int equal=1;
+    while(equal&&s.size){
+        walk_item it=s.items[--s.size];
+        a=it.a;
+        b=it.b;
+        if(a==b)continue;
+        if(a->type!=b->type){
+            equal=0;
+            break;
+        }
+        switch(a->type){
+        case JSON_ARRAY:
+            if(a->_arr.size!=b->_arr.size){
+                equal=0;
+                break;
+            }
+            if(a->_arr.arr==b->_arr.arr)break;//shared by json_clone
+            if(a->_arr.packed||b->_arr.packed){//packed items are numbers, compared right away since they're copied out
+                JSON_Element ta,tb;
+                for(size_t i=0;equal&&i<a->_arr.size;i++){
+                    JSON_Element * ia=json_array_item(&a->_arr,i,&ta);
+                    JSON_Element * ib=json_array_item(&b->_arr,i,&tb);
+                    if(ia->type!=ib->type){
+                        equal=0;
+                    }else if(ia->type==JSON_INTEGER){
+                        equal=ia->_int.i==ib->_int.i;
+                    }else if(ia->type==JSON_DOUBLE){
+                        equal=ia->_double.d==ib->_double.d;
+                    }
+                }
+                break;
+            }
+            for(size_t i=0;i<a->_arr.size;i++){
+                walk_push(&s,&a->_arr.arr[i],&b->_arr.arr[i],0);
+            }
+            break;
+        case JSON_OBJECT:{
+                if(a->_obj.tbl==b->_obj.tbl)break;
+                if(json_object_size(&a->_obj)!=json_object_size(&b->_obj)){
+                    equal=0;
+                    break;
+                }
+                //same size, so every key of a being found in b means the key sets are equal, regardless of order
+                JSON_Object_Iterator iter={0};
+                const char * key;
+                size_t key_len;
+                JSON_Element * ea;
+                while(json_object_next_n(&a->_obj,&iter,&key,&key_len,&ea)){
+                    JSON_Element * eb=json_object_get_n(&b->_obj,key,key_len);
+                    if(!eb){
+                        equal=0;
+                        break;
+                    }
+                    walk_push(&s,ea,eb,0);
+                }
+                break;
+            }
+        case JSON_PARSE_ERROR:
+        case JSON_STRING:
+            equal=json_string_length(&a->_str)==json_string_length(&b->_str)&&memcmp(json_string_data(&a->_str),json_string_data(&b->_str),json_string_length(&a->_str))==0;
+            break;
+        case JSON_INTEGER:
+            equal=a->_int.i==b->_int.i;
+            break;
+        case JSON_DOUBLE:
+            equal=a->_double.d==b->_double.d;
+            break;
+        default:
+            break;
+        }
+    }
+    free(s.items);
+    return equal;
+}
+
+static uint64_t hash_mix(uint64_t h,uint64_t v){
+    //splitmix64 finalizer over the combined value
+    h^=v+0x9E3779B97F4A7C15ull+(h<<6)+(h>>2);
+    h^=h>>30;
+    h*=0xBF58476D1CE4E5B9ull;
+    h^=h>>27;
+    h*=0x94D049BB133111EBull;
+    h^=h>>31;
+    return h;
+}
+
+static uint64_t hash_bytes(const char * s,size_t n){
+    //FNV-1a, independent of str_hash so hashes are stable across builds
+    uint64_t h=0xCBF29CE484222325ull;
+    for(size_t i=0;i<n;i++){
+        h^=(uint8_t)s[i];
+        h*=0x100000001B3ull;
+    }
+    return h;
+}
+
+uint64_t json_hash(JSON_Element * elem){
+    //every node contributes hash(path seed, node), contributions are summed, so object entry order doesn't matter
+    //but array order does, since array indices are part of the seed
+    walk_stack s={0};
+    walk_push(&s,elem,NULL,0);
+    uint64_t hash=0;
+    while(s.size){
+        walk_item it=s.items[--s.size];
+        JSON_Element * e=it.a;
+        uint64_t seed=hash_mix(it.seed,e->type==JSON_PARSE_ERROR?JSON_STRING:e->type);
+        uint64_t value=0;
+        double d;
+        switch(e->type){
+        case JSON_ARRAY:
+            value=e->_arr.size;
+            if(e->_arr.packed){//same contributions as the JSON_INTEGER/JSON_DOUBLE cases below
+                for(size_t i=0;i<e->_arr.size;i++){
+                    uint64_t item=hash_mix(hash_mix(seed,i),e->_arr.packed);
+                    uint64_t v=(uint64_t)e->_arr.ints[i];
+                    if(e->_arr.packed==JSON_DOUBLE){
+                        d=e->_arr.doubles[i]==0?0:e->_arr.doubles[i];
+                        memcpy(&v,&d,sizeof(v));
+                    }
+                    hash+=hash_mix(item,v);
+                }
+                break;
+            }
+            for(size_t i=0;i<e->_arr.size;i++){
+                walk_push(&s,&e->_arr.arr[i],NULL,hash_mix(seed,i));
+            }
+            break;
+        case JSON_OBJECT:{
+                JSON_Object_Iterator iter={0};
+                const char * key;
+                size_t key_len;
+                JSON_Element * child;
+                while(json_object_next_n(&e->_obj,&iter,&key,&key_len,&child)){
+                    value++;
+                    walk_push(&s,child,NULL,hash_mix(seed,hash_bytes(key,key_len)));
+                }
+                break;
+            }
+        case JSON_PARSE_ERROR:
+        case JSON_STRING:
+            value=hash_bytes(json_string_data(&e->_str),json_string_length(&e->_str));
+            break;
+        case JSON_INTEGER:
+            value=(uint64_t)e->_int.i;
+            break;
+        case JSON_DOUBLE:
+            d=e->_double.d==0?0:e->_double.d;//-0.0 equals 0.0
+            memcpy(&value,&d,sizeof(value));
+            break;
+        default:
+            break;
+        }
+        hash+=hash_mix(seed,value);
+    }
+    free(s.items);
+    return hash;
+}
 
 JSON_Element * parse_error(const char * fmt,...){
     JSON_String * str=&((JSON_Element*)calloc(1,sizeof(JSON_Element)))->_str;
@@ -323,12 +875,9 @@ JSON_Element * parse_error(const char * fmt,...){
     va_copy(arg2,arg1);
     size_t n=vsnprintf(NULL,0,fmt,arg2);
     va_end(arg2);
-    str->type=JSON_PARSE_ERROR;
-    str->str=calloc(n+1,sizeof(char));
-    vsnprintf(str->str,n+1,fmt,arg1);
+    vsnprintf(json_init_string_buffer(str,n),n+1,fmt,arg1);
     va_end(arg1);
-    str->str[n]=0;
-    str->len=n;
+    str->type=JSON_PARSE_ERROR;
     return (JSON_Element*)str;
 }
 
@@ -336,7 +885,7 @@ static bool is_whitespace(char c){
     return c==' '||c=='\t'||c=='\n'||c=='\r';
 }
 
-void skip_whitespace(parse_data * p){
+void json_lex_whitespace(JSON_Lexer * p){
     while(p->i<p->n){
         if(is_whitespace(p->s[p->i])){
             ++p->i;
@@ -383,101 +932,407 @@ static char unescape(char c){
     }
 }
 
-static JSON_Element * json_parse_string(parse_data * p){
-    skip_whitespace(p);
-    bool singlequote=false;
-    if(p->i>=p->n){
-        return parse_error("Expected '\"', got EOF");
-    }else if(p->s[p->i]=='\''){
-        singlequote=true;
-    }else if(p->s[p->i]!='"'){
-        return parse_error("Expected '\"', got %c",p->s[p->i]);
+#define SWAR_ONES 0x0101010101010101ull
+#define SWAR_HIGHS 0x8080808080808080ull
+
+//returns the index of the first byte from i that is the quote, a backslash, or (if stop_high) not ASCII, or n if there is none
+//plain runs are checked 8 bytes at a time
+static inline size_t scan_plain(const char * s,size_t i,size_t n,char quote,bool stop_high){
+    uint64_t q=SWAR_ONES*(unsigned char)quote;
+    uint64_t b=SWAR_ONES*(unsigned char)'\\';
+    uint64_t high=stop_high?SWAR_HIGHS:0;
+    for(;i+8<=n;i+=8){
+        uint64_t w;
+        memcpy(&w,s+i,8);
+        uint64_t x=w^q,y=w^b;
+        if(((((x-SWAR_ONES)&~x)|((y-SWAR_ONES)&~y))&SWAR_HIGHS)|(w&high))break;
     }
-    ++p->i;
-    bool reading_escape=false;
-    size_t n=0,i=p->i;
-    for(;i<p->n;++i){
-        if(reading_escape){
-            n++;
-            reading_escape=false;
-        }else if(p->s[i]=='\\'){
-            reading_escape=true;
-        }else if(p->s[i]==(singlequote?'\'':'"')){
+    for(;i<n;i++){
+        unsigned char c=s[i];
+        if(c==(unsigned char)quote||c=='\\'||(stop_high&&c>=0x80))break;
+    }
+    return i;
+}
+
+//lengths of UTF-8 sequences by lead byte, 0 for bytes that can't start one
+static const uint8_t utf8_lengths[256]={
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
+    2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
+    3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
+    4,4,4,4,4,0,0,0,0,0,0,0,0,0,0,0,
+};
+
+//same as scan_plain, but validates the UTF-8 it goes over, returns SIZE_MAX and sets bad to the offending sequence if it isn't valid
+//overlong forms, surrogates and code points above U+10FFFF are rejected
+static size_t scan_utf8(const char * str,size_t i,size_t n,char quote,size_t * bad){
+    const unsigned char * s=(const unsigned char*)str;
+    while(i<n){
+        unsigned char c=s[i];
+        if(c<0x80){
+            if(c==(unsigned char)quote||c=='\\')return i;
+            i=scan_plain(str,i+1,n,quote,true);
+            continue;
+        }
+        size_t len=utf8_lengths[c];
+        *bad=i;
+        if(len==0||len>n-i)return SIZE_MAX;
+        //second byte range depends on the lead byte, the checks are combined without branches
+        unsigned char lo=c==0xE0?0xA0:c==0xF0?0x90:0x80;
+        unsigned char hi=c==0xED?0x9F:c==0xF4?0x8F:0xBF;
+        unsigned char c2=len>2?s[i+2]:0x80;
+        unsigned char c3=len>3?s[i+3]:0x80;
+        if(!((s[i+1]>=lo)&(s[i+1]<=hi)&((c2&0xC0)==0x80)&((c3&0xC0)==0x80)))return SIZE_MAX;
+        i+=len;
+    }
+    return i;
+}
+
+static int hex_digit(char c){
+    if(c>='0'&&c<='9')return c-'0';
+    if(c>='a'&&c<='f')return c-'a'+10;
+    if(c>='A'&&c<='F')return c-'A'+10;
+    return -1;
+}
+
+static bool hex4(const char * s,size_t i,size_t n,uint32_t * out){
+    if(i+4>n)return false;
+    uint32_t v=0;
+    for(size_t k=0;k<4;k++){
+        int d=hex_digit(s[i+k]);
+        if(d<0)return false;
+        v=(v<<4)|d;
+    }
+    *out=v;
+    return true;
+}
+
+//decodes the \u escape whose 'u' is at s[i], surrogate pairs included, sets end to the index right after it
+//returns the code point, or UINT32_MAX if the escape is invalid or a lone surrogate
+static uint32_t decode_unicode_escape(const char * s,size_t i,size_t n,size_t * end){
+    uint32_t cp,lo;
+    *end=i+1;
+    if(!hex4(s,i+1,n,&cp))return UINT32_MAX;
+    *end=i+5;
+    if(cp>=0xD800&&cp<=0xDBFF){
+        if(i+6<n&&s[i+5]=='\\'&&s[i+6]=='u'&&hex4(s,i+7,n,&lo)&&lo>=0xDC00&&lo<=0xDFFF){
+            *end=i+11;
+            return 0x10000+((cp-0xD800)<<10)+(lo-0xDC00);
+        }
+        return UINT32_MAX;
+    }else if(cp>=0xDC00&&cp<=0xDFFF){
+        return UINT32_MAX;
+    }
+    return cp;
+}
+
+static size_t utf8_length(uint32_t cp){
+    return cp<0x80?1:cp<0x800?2:cp<0x10000?3:4;
+}
+
+static size_t utf8_encode(uint32_t cp,char * out){
+    if(cp<0x80){
+        out[0]=cp;
+        return 1;
+    }else if(cp<0x800){
+        out[0]=0xC0|(cp>>6);
+        out[1]=0x80|(cp&0x3F);
+        return 2;
+    }else if(cp<0x10000){
+        out[0]=0xE0|(cp>>12);
+        out[1]=0x80|((cp>>6)&0x3F);
+        out[2]=0x80|(cp&0x3F);
+        return 3;
+    }else{
+        out[0]=0xF0|(cp>>18);
+        out[1]=0x80|((cp>>12)&0x3F);
+        out[2]=0x80|((cp>>6)&0x3F);
+        out[3]=0x80|(cp&0x3F);
+        return 4;
+    }
+}
+
+static bool lex_fail(JSON_Lexer * p,JSON_Error_Code code,size_t offset,const char * expected){
+    p->error.code=code;
+    p->error.got=offset<p->n?(unsigned char)p->s[offset]:-1;
+    p->error.expected=expected;
+    p->error.offset=offset;
+    return false;
+}
+
+bool json_lex_unexpected(JSON_Lexer * p,const char * expected){
+    return lex_fail(p,JSON_ERROR_UNEXPECTED,p->i,expected);
+}
+
+bool json_lex_string_length(JSON_Lexer * p,size_t * len){
+    json_lex_whitespace(p);
+    if(p->i>=p->n||(p->s[p->i]!='\''&&p->s[p->i]!='"')){
+        return json_lex_unexpected(p,"'\"'");
+    }
+    char quote=p->s[p->i];
+    //UTF-8 is validated in the same pass that looks for the end of the string
+    bool validate=p->flags&JSON_PARSE_VALIDATE_UTF8;
+    size_t n=0,i=p->i+1;
+    while(true){
+        size_t bad=0;
+        size_t j=validate?scan_utf8(p->s,i,p->n,quote,&bad):scan_plain(p->s,i,p->n,quote,false);
+        if(j==SIZE_MAX)return lex_fail(p,JSON_ERROR_INVALID_UTF8,bad,NULL);
+        n+=j-i;
+        i=j;
+        if(i>=p->n){
+            return lex_fail(p,JSON_ERROR_UNEXPECTED,i,"'\"'");
+        }else if(p->s[i]==quote){
             break;
+        }else if(i+1>=p->n){
+            return lex_fail(p,JSON_ERROR_UNEXPECTED,i+1,"'\"'");
+        }else if(p->s[i+1]=='u'){
+            size_t start=i;
+            uint32_t cp=decode_unicode_escape(p->s,i+1,p->n,&i);
+            if(cp==UINT32_MAX)return lex_fail(p,JSON_ERROR_INVALID_ESCAPE,start,NULL);
+            n+=utf8_length(cp);
         }else{
             n++;
+            i+=2;
+        }
+    }
+    *len=n;
+    return true;
+}
+
+void json_lex_string_copy(JSON_Lexer * p,char * out){
+    char quote=p->s[p->i++];
+    size_t o=0;
+    while(true){
+        size_t j=scan_plain(p->s,p->i,p->n,quote,false);
+        if(out) memcpy(out+o,p->s+p->i,j-p->i);
+        o+=j-p->i;
+        p->i=j;
+        if(p->i>=p->n){
+            return;
+        }else if(p->s[p->i]==quote){
+            ++p->i;
+            return;
+        }else if(p->s[p->i+1]=='u'){
+            uint32_t cp=decode_unicode_escape(p->s,p->i+1,p->n,&p->i);
+            if(out){
+                o+=utf8_encode(cp,out+o);
+            }else{
+                o+=utf8_length(cp);
+            }
+        }else{
+            if(out) out[o]=unescape(p->s[p->i+1]);
+            o++;
+            p->i+=2;
         }
     }
-    if(i>=p->n){
-        return parse_error(reading_escape?"Expected '\"', got EOF":"Expected char got EOF");
+}
+
+bool json_lex_number(JSON_Lexer * p,JSON_Number * number,bool * is_double_out){
+    json_lex_whitespace(p);
+    if(p->i>=p->n) return json_lex_unexpected(p,"JSON Element");
+    bool is_double=false;
+    bool is_negative=false;
+    bool is_valid=false;
+    size_t double_digit=1;
+    number->i=0;
+    switch(p->s[p->i]){
+    case '+':
+        is_negative=false;
+        ++p->i;
+        break;
+    case '-':
+        is_negative=true;
+        ++p->i;
+        break;
+    case '.':
+        is_double=true;
+        number->d=0;
+        ++p->i;
+        break;
+    default:
+        if(p->s[p->i]<'0'||p->s[p->i]>'9'){
+            return json_lex_unexpected(p,"Number");
+        }
+        break;
     }
-    JSON_String * str=&((JSON_Element*)calloc(1,sizeof(JSON_Element)))->_str;
-    str->type=JSON_STRING;
-    str->str=calloc(n+1,sizeof(char));
-    str->str[n]=0;
-    str->len=n;
-    reading_escape=false;
-    n=0;
     for(;p->i<p->n;++p->i){
-        if(reading_escape){
-            str->str[n++]=unescape(p->s[p->i]);
-            reading_escape=false;
-        }else if(p->s[p->i]=='\\'){
-            reading_escape=true;
-        }else if(p->s[p->i]==(singlequote?'\'':'"')){
+        char c=p->s[p->i];
+        if(c>='0'&&c<='9'){
+            is_valid=true;
+            if(is_double){
+                number->d+=(c-'0')/pow(10,double_digit);
+                double_digit++;
+            }else{
+                number->i*=10;
+                number->i+=c-'0';
+            }
+        }else if(c=='.'){
+            if(is_double){
+                return json_lex_unexpected(p,"Number");
+            }
+            is_double=true;
+            number->d=number->i;
+        }else if(is_valid){
             break;
         }else{
-            str->str[n++]=p->s[p->i];
+            return json_lex_unexpected(p,"Number");
+        }
+    }
+    if(!is_valid){
+        return json_lex_unexpected(p,"Number");
+    }
+    if(is_double){
+        if(is_negative) number->d=-number->d;
+    }else{
+        if(is_negative) number->i=-number->i;
+    }
+    *is_double_out=is_double;
+    return true;
+}
+
+JSON_Element_Type json_lex_literal(JSON_Lexer * p){
+    if((p->i+4)<p->n&&p->s[p->i]=='f'&&p->s[p->i+1]=='a'&&p->s[p->i+2]=='l'&&p->s[p->i+3]=='s'&&p->s[p->i+4]=='e'){
+        p->i+=5;
+        return JSON_FALSE;
+    }else if((p->i+3)<p->n){
+        if(p->s[p->i]=='t'&&p->s[p->i+1]=='r'&&p->s[p->i+2]=='u'&&p->s[p->i+3]=='e'){
+            p->i+=4;
+            return JSON_TRUE;
+        }else if(p->s[p->i]=='n'&&p->s[p->i+1]=='u'&&p->s[p->i+2]=='l'&&p->s[p->i+3]=='l'){
+            p->i+=4;
+            return JSON_NULL;
         }
     }
+    return JSON_PARSE_ERROR;
+}
+
+static bool json_lex_skip_container(JSON_Lexer * p,char close){
+    const char * expected_close=close=='}'?"'}'":"']'";
     ++p->i;
+    json_lex_whitespace(p);
+    if(p->i<p->n&&p->s[p->i]==close){
+        ++p->i;
+        return true;
+    }
+    while(true){
+        if(close=='}'){
+            size_t len;
+            if(!json_lex_string_length(p,&len))return false;
+            json_lex_string_copy(p,NULL);
+            json_lex_whitespace(p);
+            if(p->i>=p->n||p->s[p->i]!=':'){
+                return json_lex_unexpected(p,"':'");
+            }
+            ++p->i;
+        }
+        if(!json_lex_skip(p))return false;
+        json_lex_whitespace(p);
+        if(p->i>=p->n){
+            return json_lex_unexpected(p,expected_close);
+        }else if(p->s[p->i]==','){
+            ++p->i;
+            json_lex_whitespace(p);
+            if(p->i<p->n&&p->s[p->i]==close){
+                ++p->i;
+                return true;
+            }
+        }else if(p->s[p->i]==close){
+            ++p->i;
+            return true;
+        }else{
+            return json_lex_unexpected(p,expected_close);
+        }
+    }
+}
+
+bool json_lex_skip(JSON_Lexer * p){
+    json_lex_whitespace(p);
+    if(p->i>=p->n) return json_lex_unexpected(p,"JSON Element");
+    char c=p->s[p->i];
+    if(c=='{'||c=='['){
+        return json_lex_skip_container(p,c=='{'?'}':']');
+    }else if(c=='"'||c=='\''){
+        size_t len;
+        if(!json_lex_string_length(p,&len))return false;
+        json_lex_string_copy(p,NULL);
+        return true;
+    }else if((c>='0'&&c<='9')||c=='.'||c=='-'||c=='+'){
+        JSON_Number number;
+        bool is_double;
+        return json_lex_number(p,&number,&is_double);
+    }else if(json_lex_literal(p)==JSON_PARSE_ERROR){
+        return json_lex_unexpected(p,"JSON Element");
+    }
+    return true;
+}
+
+//the parse functions return NULL on failure, with the error in p->error
+
+static JSON_Element * json_parse_string(JSON_Lexer * p){
+    size_t n;
+    if(!json_lex_string_length(p,&n)){
+        return NULL;
+    }
+    JSON_String * str=&((JSON_Element*)malloc(sizeof(JSON_Element)))->_str;
+    json_lex_string_copy(p,json_init_string_buffer(str,n));
     return (JSON_Element *)str;
 }
 
-JSON_Element * json_parse_element(parse_data * p);
+JSON_Element * json_parse_element(JSON_Lexer * p);
 
-JSON_Element * json_parse_object(parse_data * p){
-    skip_whitespace(p);
-    if(p->i>=p->n){
-        return parse_error("Expected '{', got EOF");
-    }else if(p->s[p->i]!='{'){
-        return parse_error("Expected '{', got %c",p->s[p->i]);
+JSON_Element * json_parse_object(JSON_Lexer * p){
+    json_lex_whitespace(p);
+    if(p->i>=p->n||p->s[p->i]!='{'){
+        json_lex_unexpected(p,"'{'");
+        return NULL;
     }
     ++p->i;
     JSON_Object * obj=json_make_object();
+    json_lex_whitespace(p);
+    if(p->i<p->n&&p->s[p->i]=='}'){
+        ++p->i;
+        return (JSON_Element*)obj;
+    }
     while(true){
         JSON_String * key=(JSON_String *)json_parse_string(p);
-        if(key->type==JSON_PARSE_ERROR){
+        if(!key){
             json_free_object(obj);
-            return (JSON_Element*)key;
+            return NULL;
         }
-        skip_whitespace(p);
-        if(p->i>=p->n){
+        json_lex_whitespace(p);
+        if(p->i>=p->n||p->s[p->i]!=':'){
             json_free_string(key);
             json_free_object(obj);
-            return parse_error("Expected ':', got EOF");
-        }else if(p->s[p->i]!=':'){
-            json_free_string(key);
-            json_free_object(obj);
-            return parse_error("Expected ':', got %c",p->s[p->i]);
+            json_lex_unexpected(p,"':'");
+            return NULL;
         }
         ++p->i;
         JSON_Element * e=json_parse_element(p);
-        if(e->type==JSON_PARSE_ERROR){
+        if(!e){
             json_free_string(key);
             json_free_object(obj);
-            return e;
+            return NULL;
         }
-        json_object_set_n(obj,key->str,key->len,e);
+        json_object_set_n(obj,json_string_data(key),json_string_length(key),e);
         json_free_string(key);
-        skip_whitespace(p);
+        json_lex_whitespace(p);
         if(p->i>=p->n){
-            json_free_object(obj);
-            return parse_error("Expected '}', got EOF");
+            break;
         }else if(p->s[p->i]==','){
             ++p->i;
-            skip_whitespace(p);
-            if(p->s[p->i]=='}'){
+            json_lex_whitespace(p);
+            if(p->i<p->n&&p->s[p->i]=='}'){
                 ++p->i;
                 return (JSON_Element*)obj;
             }
@@ -485,38 +1340,100 @@ JSON_Element * json_parse_object(parse_data * p){
             ++p->i;
             return (JSON_Element*)obj;
         }else{
-            json_free_object(obj);
-            return parse_error("Expected '}', got %c",p->s[p->i]);
+            break;
         }
     }
     json_free_object(obj);
-    return parse_error("Expected '}', got EOF");
+    json_lex_unexpected(p,"'}'");
+    return NULL;
 }
 
-JSON_Element * json_parse_array(parse_data * p){
-    skip_whitespace(p);
-    if(p->i>=p->n){
-        return parse_error("Expected '[', got EOF");
-    }else if(p->s[p->i]!='['){
-        return parse_error("Expected '[', got %c",p->s[p->i]);
+static bool is_number_start(char c){
+    return (c>='0'&&c<='9')||c=='.'||c=='-'||c=='+';
+}
+
+//JSON_PARSE_PACK_NUMBERS, parses the leading run of numbers of one type straight into a packed block
+//returns 1 if that was the whole array, 0 if an item of another kind follows (arr is unpacked, and p->i is at that item), -1 on error
+static int parse_packed(JSON_Lexer * p,JSON_Array * arr){
+    size_t alloc=0;
+    while(p->i<p->n&&is_number_start(p->s[p->i])){
+        size_t start=p->i;
+        JSON_Number number;
+        bool is_double;
+        if(!json_lex_number(p,&number,&is_double))return -1;
+        JSON_Element_Type type=is_double?JSON_DOUBLE:JSON_INTEGER;
+        if(arr->packed&&arr->packed!=type){
+            p->i=start;
+            break;
+        }
+        if(arr->size==alloc){
+            alloc=alloc?alloc*2:16;
+            array_realloc(arr,alloc,sizeof(JSON_Number));
+            arr->packed=type;
+        }
+        if(is_double){
+            arr->doubles[arr->size++]=number.d;
+        }else{
+            arr->ints[arr->size++]=number.i;
+        }
+        json_lex_whitespace(p);
+        bool end=false;
+        if(p->i<p->n&&p->s[p->i]==','){
+            ++p->i;
+            json_lex_whitespace(p);
+            end=p->i<p->n&&p->s[p->i]==']';
+        }else if(p->i<p->n&&p->s[p->i]==']'){
+            end=true;
+        }else{
+            json_lex_unexpected(p,"']'");
+            return -1;
+        }
+        if(end){
+            ++p->i;
+            array_realloc(arr,arr->size,sizeof(JSON_Number));
+            return 1;
+        }
+    }
+    json_array_unpack(arr);
+    return 0;
+}
+
+JSON_Element * json_parse_array(JSON_Lexer * p){
+    json_lex_whitespace(p);
+    if(p->i>=p->n||p->s[p->i]!='['){
+        json_lex_unexpected(p,"'['");
+        return NULL;
     }
     ++p->i;
     JSON_Array * arr=json_make_array();
+    json_lex_whitespace(p);
+    if(p->i<p->n&&p->s[p->i]==']'){
+        ++p->i;
+        return (JSON_Element*)arr;
+    }
+    if(p->flags&JSON_PARSE_PACK_NUMBERS){
+        int packed=parse_packed(p,arr);
+        if(packed<0){
+            json_free_array(arr);
+            return NULL;
+        }else if(packed>0){
+            return (JSON_Element*)arr;
+        }
+    }
     while(true){
         JSON_Element * e=json_parse_element(p);
-        if(e->type==JSON_PARSE_ERROR){
+        if(!e){
             json_free_array(arr);
-            return e;
+            return NULL;
         }
         json_array_push(arr,e);
-        skip_whitespace(p);
+        json_lex_whitespace(p);
         if(p->i>=p->n){
-            json_free_array(arr);
-            return parse_error("Expected ']', got EOF");
+            break;
         }else if(p->s[p->i]==','){
             ++p->i;
-            skip_whitespace(p);
-            if(p->s[p->i]==']'){
+            json_lex_whitespace(p);
+            if(p->i<p->n&&p->s[p->i]==']'){
                 ++p->i;
                 return (JSON_Element*)arr;
             }
@@ -524,99 +1441,33 @@ JSON_Element * json_parse_array(parse_data * p){
             ++p->i;
             return (JSON_Element*)arr;
         }else{
-            json_free_array(arr);
-            return parse_error("Expected ']', got %c",p->s[p->i]);
+            break;
         }
     }
     json_free_array(arr);
-    return parse_error("Expected ']', got EOF");
+    json_lex_unexpected(p,"']'");
+    return NULL;
 }
 
-typedef union numberdata {
-    double d;
-    int64_t i;
-} numberdata;
-
-JSON_Element * json_parse_number(parse_data * p){
-    skip_whitespace(p);
-    if(p->i>=p->n) return parse_error("Expected JSON Element, got EOF");
-    bool is_double=false;
-    bool is_negative=false;
-    bool is_valid=false;
-    size_t double_digit=1;
-    numberdata number={0};
-    switch(p->s[p->i]){
-    case '+':
-        is_negative=false;
-        ++p->i;
-        break;
-    case '-':
-        is_negative=true;
-        ++p->i;
-        break;
-    case '.':
-        is_double=true;
-        number.d=0;
-        ++p->i;
-        break;
-    default:
-        if(p->s[p->i]<'0'||p->s[p->i]>'9'){
-            return parse_error("Expected Number, got %c",p->s[p->i]);
-        }
-        break;
-    }
-    for(;p->i<p->n;++p->i){
-        char c=p->s[p->i];
-        if(c>='0'&&c<='9'){
-            is_valid=true;
-            if(is_double){
-                number.d+=(c-'0')/pow(10,double_digit);
-                double_digit++;
-            }else{
-                number.i*=10;
-                number.i+=c-'0';
-            }
-        }else if(c=='.'){
-            if(is_double){
-                return parse_error("Expected Number, got %c",c);
-            }
-            is_double=true;
-            number.d=number.i;
-        }else if(is_valid){
-            if(is_double){
-                JSON_Double * d=&((JSON_Element*)calloc(1,sizeof(JSON_Element)))->_double;
-                d->type=JSON_DOUBLE;
-                d->d=is_negative?-number.d:number.d;
-                return (JSON_Element*)d;
-            }else{
-                JSON_Integer * i=&((JSON_Element*)calloc(1,sizeof(JSON_Element)))->_int;
-                i->type=JSON_INTEGER;
-                i->i=is_negative?-number.i:number.i;
-                return (JSON_Element*)i;
-            }
-        }else{
-            return parse_error("Expected Number, got %c",c);
-        }
+JSON_Element * json_parse_number(JSON_Lexer * p){
+    JSON_Number number;
+    bool is_double;
+    if(!json_lex_number(p,&number,&is_double)){
+        return NULL;
     }
-    if(is_valid){
-        if(is_double){
-            JSON_Double * d=&((JSON_Element*)calloc(1,sizeof(JSON_Element)))->_double;
-            d->type=JSON_DOUBLE;
-            d->d=is_negative?-number.d:number.d;
-            return (JSON_Element*)d;
-        }else{
-            JSON_Integer * i=&((JSON_Element*)calloc(1,sizeof(JSON_Element)))->_int;
-            i->type=JSON_INTEGER;
-            i->i=is_negative?-number.i:number.i;
-            return (JSON_Element*)i;
-        }
+    if(is_double){
+        return (JSON_Element*)json_make_double(number.d);
+    }else{
+        return (JSON_Element*)json_make_integer(number.i);
     }
-    return parse_error("Expected Number, got EOF");
 }
 
-JSON_Element * json_parse_element(parse_data * p){
-    skip_whitespace(p);
-    if(p->i>=p->n) return parse_error("Expected JSON Element, got EOF");
+JSON_Element * json_parse_element(JSON_Lexer * p){
+    json_lex_whitespace(p);
+    if(p->i>=p->n){
+        json_lex_unexpected(p,"JSON Element");
+        return NULL;
+    }
     char c=p->s[p->i];
     switch(c){
     case '{':
@@ -629,31 +1480,112 @@ JSON_Element * json_parse_element(parse_data * p){
     default:
         if((c>='0'&&c<='9')||c=='.'||c=='-'||c=='+'){
             return json_parse_number(p);
-        }else if((p->i+4)<p->n&&p->s[p->i]=='f'&&p->s[p->i+1]=='a'&&p->s[p->i+2]=='l'&&p->s[p->i+3]=='s'&&p->s[p->i+3]=='e'){
-            JSON_Element * e=calloc(1,sizeof(JSON_Element));
-            e->type=JSON_FALSE;
-            p->i+=5;
-            return e;
-        }else if((p->i+3)<p->n){
-            if(p->s[p->i]=='t'&&p->s[p->i+1]=='r'&&p->s[p->i+2]=='u'&&p->s[p->i+3]=='e'){
-                JSON_Element * e=calloc(1,sizeof(JSON_Element));
-                e->type=JSON_TRUE;
-                p->i+=4;
-                return e;
-            }else if(p->s[p->i]=='n'&&p->s[p->i+1]=='u'&&p->s[p->i+2]=='l'&&p->s[p->i+3]=='l'){
+        }else{
+            JSON_Element_Type type=json_lex_literal(p);
+            if(type!=JSON_PARSE_ERROR){
                 JSON_Element * e=calloc(1,sizeof(JSON_Element));
-                e->type=JSON_NULL;
-                p->i+=4;
+                e->type=type;
                 return e;
             }
         }
-        return parse_error("Expected JSON Element, got %c",c);
+        json_lex_unexpected(p,"JSON Element");
+        return NULL;
     }
 }
 
+JSON_Element * json_try_parse_n(const char * s,size_t n,uint32_t flags,JSON_Error * error){
+    JSON_Lexer p = {.i=0,.s=s,.n=n,.flags=flags};
+    JSON_Element * e=json_parse_element(&p);
+    if(error) *error=e?(JSON_Error){0}:p.error;
+    return e;
+}
+
+//appends to buf as far as it fits, the length keeps counting past the end like snprintf
+static size_t error_append(char * buf,size_t size,size_t len,const char * s,size_t n){
+    if(len<size) memcpy(buf+len,s,len+n<size?n:size-len);
+    return len+n;
+}
+
+size_t json_error_message(const JSON_Error * error,char * buf,size_t size){
+    //hand formatted, this runs for every rejected document that still uses the element api
+    static const char hex[]="0123456789abcdef";
+    size_t len=0;
+    switch(error->code){
+    case JSON_ERROR_NONE:
+        len=error_append(buf,size,len,"No error",8);
+        break;
+    case JSON_ERROR_UNEXPECTED:
+        len=error_append(buf,size,len,"Expected ",9);
+        len=error_append(buf,size,len,error->expected,strlen(error->expected));
+        len=error_append(buf,size,len,", got ",6);
+        if(error->got<0){
+            len=error_append(buf,size,len,"EOF",3);
+        }else if(error->got<0x20||error->got>=0x7F){
+            char b[4]={'0','x',hex[(error->got>>4)&0xF],hex[error->got&0xF]};
+            len=error_append(buf,size,len,b,4);
+        }else{
+            char c=error->got;
+            len=error_append(buf,size,len,&c,1);
+        }
+        break;
+    case JSON_ERROR_INVALID_ESCAPE:
+        len=error_append(buf,size,len,"Invalid \\u escape",17);
+        break;
+    case JSON_ERROR_INVALID_UTF8:
+        len=error_append(buf,size,len,"Invalid UTF-8 in string",23);
+        break;
+    default:
+        len=error_append(buf,size,len,"Unknown error",13);
+        break;
+    }
+    if(error->code!=JSON_ERROR_NONE){
+        char digits[20];
+        size_t d=sizeof(digits),offset=error->offset;
+        do{
+            digits[--d]='0'+offset%10;
+            offset/=10;
+        }while(offset);
+        len=error_append(buf,size,len," at offset ",11);
+        len=error_append(buf,size,len,digits+d,sizeof(digits)-d);
+    }
+    if(size) buf[len<size?len:size-1]=0;
+    return len;
+}
+
+void json_error_location(const JSON_Error * error,const char * s,size_t n,size_t * line,size_t * column){
+    size_t end=error->offset<n?error->offset:n;
+    size_t l=1,start=0;
+    const char * nl;
+    while((nl=memchr(s+start,'\n',end-start))){
+        start=nl-s+1;
+        l++;
+    }
+    *line=l;
+    *column=end-start+1;
+}
+
+JSON_Element * json_error_element(const JSON_Error * error){
+    char buf[128];
+    size_t n=json_error_message(error,buf,sizeof(buf));
+    if(n>=sizeof(buf))n=sizeof(buf)-1;
+    JSON_String * str=&((JSON_Element*)malloc(sizeof(JSON_Element)))->_str;
+    json_init_string_n(str,buf,n);
+    str->type=JSON_PARSE_ERROR;
+    return (JSON_Element*)str;
+}
+
 JSON_Element * json_parse_n(const char * data,size_t len){
-    parse_data p = {.i=0,.s=data,.n=len};
-    return json_parse_element(&p);
+    return json_parse_flags_n(data,len,0);
+}
+
+JSON_Element * json_parse_flags_n(const char * data,size_t len,uint32_t flags){
+    JSON_Error error;
+    JSON_Element * e=json_try_parse_n(data,len,flags,&error);
+    return e?e:json_error_element(&error);
+}
+
+JSON_Element * json_parse_flags(const char * s,uint32_t flags){
+    return json_parse_flags_n(s,strlen(s),flags);
 }
 
 void write_indent(FILE * f,size_t indentation){
@@ -695,62 +1627,143 @@ void json_write_element(FILE * f,JSON_Element * elem,size_t indentation){
         fprintf(f,"null");
         break;
     case JSON_PARSE_ERROR:
-        fprintf(f,"PARSE ERROR: %s",elem->_str.str);
+        fprintf(f,"PARSE ERROR: %s",json_string_data(&elem->_str));
         break;
     }
 }
 
-static bool needs_escape(char c){
-    switch(c){
-    case '\a':
-    case '\b':
-    case '\t':
-    case '\n':
-    case '\v':
-    case '\f':
-    case '\r':
-    case '\\':
-    case '\"':
-    case '\'':
-        return true;
-    default:
-        return false;
+//writes str as a JSON string, quotes, backslashes and control chars are escaped, everything else (UTF-8 included) is written as is
+static void write_quoted(FILE * f,const char * str,size_t len){
+    static const char hex[]="0123456789abcdef";
+    fputc('"',f);
+    size_t run=0;
+    for(size_t i=0;i<len;i++){
+        unsigned char c=str[i];
+        if(c>=0x20&&c!='"'&&c!='\\')continue;
+        fwrite(str+run,1,i-run,f);
+        run=i+1;
+        fputc('\\',f);
+        switch(c){
+        case '\b':
+            fputc('b',f);
+            break;
+        case '\t':
+            fputc('t',f);
+            break;
+        case '\n':
+            fputc('n',f);
+            break;
+        case '\f':
+            fputc('f',f);
+            break;
+        case '\r':
+            fputc('r',f);
+            break;
+        case '"':
+        case '\\':
+            fputc(c,f);
+            break;
+        default:
+            fputc('u',f);
+            fputc('0',f);
+            fputc('0',f);
+            fputc(hex[c>>4],f);
+            fputc(hex[c&0xF],f);
+            break;
+        }
     }
+    fwrite(str+run,1,len-run,f);
+    fputc('"',f);
 }
 
-static char escape(char c){
-    switch(c){
-    case '\a':
-        return 'a';
-    case '\b':
-        return 'b';
-    case '\t':
-        return 't';
-    case '\n':
-        return 'n';
-    case '\v':
-        return 'v';
-    case '\f':
-        return 'f';
-    case '\r':
-        return 'r';
-    default:
-        return c;
+#define WRITE_BUFFER_INITIAL (64*1024)
+
+void write_grow(write_buffer * b,size_t n){
+    size_t alloc=b->alloc?b->alloc:WRITE_BUFFER_INITIAL;
+    while(alloc<b->len+n)alloc*=2;
+    b->s=realloc(b->s,alloc);
+    if(!b->s)OOM_EXIT();
+    b->alloc=alloc;
+}
+
+void write_escaped(write_buffer * b,const char * str,size_t len){
+    static const char hex[]="0123456789abcdef";
+    size_t run=0;
+    for(size_t i=0;i<len;i++){
+        unsigned char c=str[i];
+        if(c>=0x20&&c!='"'&&c!='\\')continue;
+        write_put(b,str+run,i-run);
+        run=i+1;
+        write_reserve(b,6);
+        b->s[b->len++]='\\';
+        switch(c){
+        case '\b':
+            b->s[b->len++]='b';
+            break;
+        case '\t':
+            b->s[b->len++]='t';
+            break;
+        case '\n':
+            b->s[b->len++]='n';
+            break;
+        case '\f':
+            b->s[b->len++]='f';
+            break;
+        case '\r':
+            b->s[b->len++]='r';
+            break;
+        case '"':
+        case '\\':
+            b->s[b->len++]=c;
+            break;
+        default:
+            b->s[b->len++]='u';
+            b->s[b->len++]='0';
+            b->s[b->len++]='0';
+            b->s[b->len++]=hex[c>>4];
+            b->s[b->len++]=hex[c&0xF];
+            break;
+        }
     }
+    write_put(b,str+run,len-run);
 }
 
-static void write_quoted(FILE * f,const char * str){
-    fputc('"',f);
-    char c;
-    while((c=*(str++))){
-        if(needs_escape(c)){
-            fputc('\\',f);
-            fputc(escape(c),f);
+void write_integer(write_buffer * b,int64_t i){
+    char tmp[20];
+    size_t n=0;
+    uint64_t u=i<0?0-(uint64_t)i:(uint64_t)i;
+    do{
+        tmp[n++]='0'+(u%10);
+        u/=10;
+    }while(u);
+    write_reserve(b,n+1);
+    if(i<0)b->s[b->len++]='-';
+    while(n)b->s[b->len++]=tmp[--n];
+}
+
+void write_double(write_buffer * b,double d){
+    write_reserve(b,32);
+    int n=snprintf(b->s+b->len,b->alloc-b->len,"%f",d);
+    if((size_t)n>=b->alloc-b->len){//only huge magnitudes, %f doesn't use exponents
+        write_reserve(b,n+1);
+        snprintf(b->s+b->len,b->alloc-b->len,"%f",d);
+    }
+    b->len+=n;
+}
+
+void write_packed_items(write_buffer * b,JSON_Array * arr,size_t first,size_t count,size_t indentation){
+    for(size_t i=first;i<first+count;i++){
+        write_reserve(b,2+(indentation+1)*2);
+        if(i)b->s[b->len++]=',';
+        b->s[b->len++]='\n';
+        memset(b->s+b->len,' ',(indentation+1)*2);
+        b->len+=(indentation+1)*2;
+        if(arr->packed==JSON_INTEGER){
+            write_integer(b,arr->ints[i]);
         }else{
-            fputc(c,f);
+            write_double(b,arr->doubles[i]);
         }
     }
-    fputc('"',f);
 }
 
 void json_write_object(FILE * f,JSON_Object * obj,size_t indentation){
@@ -768,7 +1781,7 @@ void json_write_object(FILE * f,JSON_Object * obj,size_t indentation){
                     fputc('\n',f);
                 }
                 write_indent(f,indentation+1);
-                write_quoted(f,arr[j].key);
+                write_quoted(f,arr[j].key,arr[j].len);
                 fputc(':',f);
                 json_write_element(f,&arr[j].elem,indentation+1);
             }
@@ -784,10 +1797,21 @@ void json_write_object(FILE * f,JSON_Object * obj,size_t indentation){
 
 }
 
+#define PACKED_WRITE_ITEMS 4096
+
 void json_write_array(FILE * f,JSON_Array * arr,size_t indentation){
     fputc('[',f);
     bool first=true;
-    if(arr->size&&arr->arr){
+    if(arr->packed){//formatted into a buffer a slice at a time instead of a stdio call per char
+        write_buffer b={0};
+        for(size_t i=0;i<arr->size;i+=PACKED_WRITE_ITEMS){
+            b.len=0;
+            write_packed_items(&b,arr,i,arr->size-i<PACKED_WRITE_ITEMS?arr->size-i:PACKED_WRITE_ITEMS,indentation);
+            fwrite(b.s,1,b.len,f);
+        }
+        free(b.s);
+        first=arr->size==0;
+    }else if(arr->size&&arr->arr){
         JSON_Element * a=arr->arr;
         for(uint32_t i=0;i<arr->size;i++){
             if(first){
@@ -811,7 +1835,7 @@ void json_write_array(FILE * f,JSON_Array * arr,size_t indentation){
 }
 
 void json_write_string(FILE * f,JSON_String * str,size_t indentation){
-    write_quoted(f,str->str);
+    write_quoted(f,json_string_data(str),json_string_length(str));
 }
 
 void json_print_element(JSON_Element * elem,size_t indentation){
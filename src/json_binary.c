@@ -0,0 +1,490 @@
+#include "json_binary.h"
+#include "json_internal.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BINARY_MAGIC "JSNB"
+#define BINARY_VERSION 1
+#define HEADER_SIZE 16
+#define NODE_HEADER_SIZE 8
+#define OBJECT_ENTRY_SIZE 24
+
+static uint32_t binary_key_hash(const char * s,size_t n){
+    //fixed hash (FNV-1a), files must stay readable even if str_hash is replaced
+    uint32_t hash=2166136261u;
+    for(size_t i=0;i<n;i++){
+        hash^=(uint8_t)s[i];
+        hash*=16777619u;
+    }
+    return hash;
+}
+
+static uint32_t read_u32(const uint8_t * p){
+    uint32_t v;
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+static uint64_t read_u64(const uint8_t * p){
+    uint64_t v;
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+//writing
+
+typedef struct key_slot {
+    const char * key;
+    size_t len;
+    uint32_t hash;
+    uint64_t offset;
+} key_slot;
+
+typedef struct binary_writer {
+    uint8_t * data;
+    size_t size;
+    size_t alloc;
+    key_slot * keys;//open addressing, interns object keys so repeated keys are stored once
+    size_t keys_count;
+    size_t keys_alloc;
+} binary_writer;
+
+typedef struct sort_entry {
+    uint64_t key;
+    uint64_t value;
+    uint32_t hash;
+} sort_entry;
+
+static void writer_reserve(binary_writer * w,size_t n){
+    if(w->size+n<=w->alloc)return;
+    size_t new_alloc=w->alloc?w->alloc:256;
+    while(new_alloc<w->size+n)new_alloc*=2;//growth factor 2
+    w->data=realloc(w->data,new_alloc);
+    if(!w->data){
+        OOM_EXIT();
+    }
+    w->alloc=new_alloc;
+}
+
+static uint64_t writer_node(binary_writer * w,uint32_t type,size_t payload){
+    size_t n=(NODE_HEADER_SIZE+payload+7)&~(size_t)7;
+    writer_reserve(w,n);
+    uint64_t offset=w->size;
+    memset(w->data+offset,0,n);
+    memcpy(w->data+offset,&type,sizeof(type));
+    w->size+=n;
+    return offset;
+}
+
+static void writer_put_u64(binary_writer * w,uint64_t at,uint64_t v){
+    memcpy(w->data+at,&v,sizeof(v));
+}
+
+static uint64_t write_string_node(binary_writer * w,const char * s,size_t n){
+    uint64_t offset=writer_node(w,JSON_STRING,8+n+1);
+    writer_put_u64(w,offset+NODE_HEADER_SIZE,n);
+    memcpy(w->data+offset+NODE_HEADER_SIZE+8,s,n);
+    return offset;
+}
+
+static void keys_grow(binary_writer * w){
+    size_t new_alloc=w->keys_alloc?w->keys_alloc*2:64;
+    key_slot * slots=calloc(new_alloc,sizeof(key_slot));
+    if(!slots){
+        OOM_EXIT();
+    }
+    for(size_t i=0;i<w->keys_alloc;i++){
+        if(!w->keys[i].key)continue;
+        size_t j=w->keys[i].hash&(new_alloc-1);
+        while(slots[j].key)j=(j+1)&(new_alloc-1);
+        slots[j]=w->keys[i];
+    }
+    free(w->keys);
+    w->keys=slots;
+    w->keys_alloc=new_alloc;
+}
+
+static uint64_t write_key(binary_writer * w,const char * key,size_t n,uint32_t hash){
+    if((w->keys_count+1)*2>w->keys_alloc)keys_grow(w);
+    size_t i=hash&(w->keys_alloc-1);
+    while(w->keys[i].key){
+        if(w->keys[i].hash==hash&&w->keys[i].len==n&&memcmp(w->keys[i].key,key,n)==0){
+            return w->keys[i].offset;
+        }
+        i=(i+1)&(w->keys_alloc-1);
+    }
+    w->keys[i].key=key;
+    w->keys[i].len=n;
+    w->keys[i].hash=hash;
+    w->keys[i].offset=write_string_node(w,key,n);
+    ++w->keys_count;
+    return w->keys[i].offset;
+}
+
+static int compare_sort_entry(const void * a,const void * b){
+    uint32_t ha=((const sort_entry*)a)->hash;
+    uint32_t hb=((const sort_entry*)b)->hash;
+    return (ha>hb)-(ha<hb);
+}
+
+static uint64_t write_element(binary_writer * w,JSON_Element * elem);
+
+static uint64_t write_array(binary_writer * w,JSON_Array * arr){
+    //children are written first (post-order), so their offsets are known when the container is written
+    uint64_t * offsets=arr->size?malloc(arr->size*sizeof(uint64_t)):NULL;
+    if(arr->size&&!offsets){
+        OOM_EXIT();
+    }
+    JSON_Element tmp;
+    for(size_t i=0;i<arr->size;i++){
+        offsets[i]=write_element(w,json_array_item(arr,i,&tmp));
+    }
+    uint64_t offset=writer_node(w,JSON_ARRAY,8+arr->size*8);
+    writer_put_u64(w,offset+NODE_HEADER_SIZE,arr->size);
+    if(arr->size) memcpy(w->data+offset+NODE_HEADER_SIZE+8,offsets,arr->size*8);
+    free(offsets);
+    return offset;
+}
+
+static uint64_t write_object(binary_writer * w,JSON_Object * obj){
+    size_t count=json_object_size(obj);
+    sort_entry * entries=count?malloc(count*sizeof(sort_entry)):NULL;
+    if(count&&!entries){
+        OOM_EXIT();
+    }
+    JSON_Object_Iterator it={0};
+    const char * key;
+    size_t n;
+    JSON_Element * elem;
+    size_t i=0;
+    while(json_object_next_n(obj,&it,&key,&n,&elem)){
+        entries[i].hash=binary_key_hash(key,n);
+        entries[i].key=write_key(w,key,n,entries[i].hash);
+        entries[i].value=write_element(w,elem);
+        i++;
+    }
+    if(count) qsort(entries,count,sizeof(sort_entry),compare_sort_entry);
+    uint64_t offset=writer_node(w,JSON_OBJECT,8+count*OBJECT_ENTRY_SIZE);
+    writer_put_u64(w,offset+NODE_HEADER_SIZE,count);
+    uint8_t * p=w->data+offset+NODE_HEADER_SIZE+8;
+    for(i=0;i<count;i++,p+=OBJECT_ENTRY_SIZE){
+        memcpy(p,&entries[i].key,8);
+        memcpy(p+8,&entries[i].value,8);
+        memcpy(p+16,&entries[i].hash,4);
+    }
+    free(entries);
+    return offset;
+}
+
+static uint64_t write_element(binary_writer * w,JSON_Element * elem){
+    uint64_t offset;
+    switch(elem->type){
+    case JSON_ARRAY:
+        return write_array(w,&elem->_arr);
+    case JSON_OBJECT:
+        return write_object(w,&elem->_obj);
+    case JSON_PARSE_ERROR:
+    case JSON_STRING:
+        return write_string_node(w,json_string_data(&elem->_str),json_string_length(&elem->_str));
+    case JSON_INTEGER:
+        offset=writer_node(w,JSON_INTEGER,8);
+        memcpy(w->data+offset+NODE_HEADER_SIZE,&elem->_int.i,8);
+        return offset;
+    case JSON_DOUBLE:
+        offset=writer_node(w,JSON_DOUBLE,8);
+        memcpy(w->data+offset+NODE_HEADER_SIZE,&elem->_double.d,8);
+        return offset;
+    default:
+        return writer_node(w,elem->type,0);
+    }
+}
+
+void * json_write_binary_buffer(JSON_Element * elem,size_t * size){
+    binary_writer w={0};
+    writer_reserve(&w,HEADER_SIZE);
+    memset(w.data,0,HEADER_SIZE);
+    w.size=HEADER_SIZE;
+    uint64_t root=write_element(&w,elem);
+    uint32_t version=BINARY_VERSION;
+    memcpy(w.data,BINARY_MAGIC,4);
+    memcpy(w.data+4,&version,4);
+    writer_put_u64(&w,8,root);
+    free(w.keys);
+    *size=w.size;
+    return w.data;
+}
+
+int json_write_binary(FILE * f,JSON_Element * elem){
+    size_t size;
+    void * data=json_write_binary_buffer(elem,&size);
+    size_t written=fwrite(data,1,size,f);
+    free(data);
+    return written!=size;
+}
+
+//reading
+
+static bool node_valid(const JSON_Binary * bin,JSON_Binary_Value v,size_t payload){
+    return v>=HEADER_SIZE&&(v&7)==0&&v<=bin->size&&(bin->size-v)>=NODE_HEADER_SIZE+payload;
+}
+
+int json_binary_open(JSON_Binary * bin,const void * data,size_t size){
+    const uint8_t * p=data;
+    if(size<HEADER_SIZE||memcmp(p,BINARY_MAGIC,4)!=0||read_u32(p+4)!=BINARY_VERSION){
+        return 1;
+    }
+    bin->data=p;
+    bin->size=size;
+    if(!node_valid(bin,read_u64(p+8),0)){
+        return 1;
+    }
+    return 0;
+}
+
+JSON_Binary_Value json_binary_root(const JSON_Binary * bin){
+    return read_u64(bin->data+8);
+}
+
+JSON_Element_Type json_binary_type(const JSON_Binary * bin,JSON_Binary_Value v){
+    if(!node_valid(bin,v,0))return JSON_PARSE_ERROR;
+    uint32_t type=read_u32(bin->data+v);
+    return type<JSON_PARSE_ERROR?(JSON_Element_Type)type:JSON_PARSE_ERROR;
+}
+
+int64_t json_binary_integer(const JSON_Binary * bin,JSON_Binary_Value v){
+    switch(json_binary_type(bin,v)){
+    case JSON_INTEGER:
+        if(!node_valid(bin,v,8))return 0;
+        return (int64_t)read_u64(bin->data+v+NODE_HEADER_SIZE);
+    case JSON_DOUBLE:
+        return (int64_t)json_binary_double(bin,v);
+    default:
+        return 0;
+    }
+}
+
+double json_binary_double(const JSON_Binary * bin,JSON_Binary_Value v){
+    double d;
+    switch(json_binary_type(bin,v)){
+    case JSON_DOUBLE:
+        if(!node_valid(bin,v,8))return 0;
+        memcpy(&d,bin->data+v+NODE_HEADER_SIZE,8);
+        return d;
+    case JSON_INTEGER:
+        return (double)json_binary_integer(bin,v);
+    default:
+        return 0;
+    }
+}
+
+static const char * binary_string(const JSON_Binary * bin,JSON_Binary_Value v,size_t * len){
+    if(!node_valid(bin,v,8))return NULL;
+    uint64_t n=read_u64(bin->data+v+NODE_HEADER_SIZE);
+    if(n>=bin->size||!node_valid(bin,v,8+n+1))return NULL;
+    if(bin->data[v+NODE_HEADER_SIZE+8+n]!=0)return NULL;
+    if(len) *len=n;
+    return (const char *)bin->data+v+NODE_HEADER_SIZE+8;
+}
+
+const char * json_binary_string(const JSON_Binary * bin,JSON_Binary_Value v,size_t * len){
+    if(json_binary_type(bin,v)!=JSON_STRING)return NULL;
+    return binary_string(bin,v,len);
+}
+
+size_t json_binary_size(const JSON_Binary * bin,JSON_Binary_Value v){
+    size_t entry_size;
+    switch(json_binary_type(bin,v)){
+    case JSON_ARRAY:
+        entry_size=8;
+        break;
+    case JSON_OBJECT:
+        entry_size=OBJECT_ENTRY_SIZE;
+        break;
+    default:
+        return 0;
+    }
+    if(!node_valid(bin,v,8))return 0;
+    uint64_t count=read_u64(bin->data+v+NODE_HEADER_SIZE);
+    if(count>(bin->size/entry_size)||!node_valid(bin,v,8+count*entry_size))return 0;
+    return count;
+}
+
+static JSON_Binary_Value child_offset(JSON_Binary_Value parent,JSON_Binary_Value child){
+    //children always precede their container, rejecting anything else keeps malformed input from forming cycles
+    return child<parent?child:0;
+}
+
+JSON_Binary_Value json_binary_array_get(const JSON_Binary * bin,JSON_Binary_Value arr,size_t index){
+    if(json_binary_type(bin,arr)!=JSON_ARRAY||index>=json_binary_size(bin,arr))return 0;
+    return child_offset(arr,read_u64(bin->data+arr+NODE_HEADER_SIZE+8+index*8));
+}
+
+static const uint8_t * object_entry(const JSON_Binary * bin,JSON_Binary_Value obj,size_t index){
+    return bin->data+obj+NODE_HEADER_SIZE+8+index*OBJECT_ENTRY_SIZE;
+}
+
+const char * json_binary_object_key(const JSON_Binary * bin,JSON_Binary_Value obj,size_t index,size_t * len){
+    if(json_binary_type(bin,obj)!=JSON_OBJECT||index>=json_binary_size(bin,obj))return NULL;
+    return binary_string(bin,read_u64(object_entry(bin,obj,index)),len);
+}
+
+JSON_Binary_Value json_binary_object_value(const JSON_Binary * bin,JSON_Binary_Value obj,size_t index){
+    if(json_binary_type(bin,obj)!=JSON_OBJECT||index>=json_binary_size(bin,obj))return 0;
+    return child_offset(obj,read_u64(object_entry(bin,obj,index)+8));
+}
+
+JSON_Binary_Value json_binary_object_get_n(const JSON_Binary * bin,JSON_Binary_Value obj,const char * key,size_t n){
+    if(json_binary_type(bin,obj)!=JSON_OBJECT)return 0;
+    size_t count=json_binary_size(bin,obj);
+    uint32_t hash=binary_key_hash(key,n);
+    size_t lo=0,hi=count;
+    while(lo<hi){//find first entry with a matching hash
+        size_t mid=lo+(hi-lo)/2;
+        if(read_u32(object_entry(bin,obj,mid)+16)<hash){
+            lo=mid+1;
+        }else{
+            hi=mid;
+        }
+    }
+    for(;lo<count;lo++){
+        const uint8_t * entry=object_entry(bin,obj,lo);
+        if(read_u32(entry+16)!=hash)break;
+        size_t len;
+        const char * k=binary_string(bin,read_u64(entry),&len);
+        if(k&&len==n&&memcmp(k,key,n)==0){
+            return child_offset(obj,read_u64(entry+8));
+        }
+    }
+    return 0;
+}
+
+JSON_Binary_Value json_binary_object_get(const JSON_Binary * bin,JSON_Binary_Value obj,const char * key){
+    return json_binary_object_get_n(bin,obj,key,strlen(key));
+}
+
+//reading is iterative, containers being filled are kept in an explicit stack, and nesting is capped at JSON_BINARY_MAX_DEPTH
+//so malformed or hostile input can't exhaust the call stack here or in the code that frees the tree
+//every value node is read at most once, offsets pointing at the same node could otherwise expand a small input exponentially
+
+typedef struct read_frame {
+    JSON_Binary_Value v;
+    JSON_Element * e;//points into the parent container, which isn't modified until this frame is done
+    size_t index;
+    size_t count;
+} read_frame;
+
+static JSON_Element * read_node(const JSON_Binary * bin,JSON_Binary_Value v,JSON_Element * e){//fills e, containers are left empty, returns an error element or NULL
+    size_t len;
+    const char * s;
+    switch(json_binary_type(bin,v)){
+    case JSON_ARRAY:
+        json_init_array(&e->_arr);
+        return NULL;
+    case JSON_OBJECT:
+        json_init_object(&e->_obj);
+        return NULL;
+    case JSON_STRING:
+        s=json_binary_string(bin,v,&len);
+        if(!s)return parse_error("Invalid binary string");
+        json_init_string_n(&e->_str,s,len);
+        return NULL;
+    case JSON_INTEGER:
+        if(!node_valid(bin,v,8))return parse_error("Invalid binary integer");
+        e->_int.type=JSON_INTEGER;
+        e->_int.i=json_binary_integer(bin,v);
+        return NULL;
+    case JSON_DOUBLE:
+        if(!node_valid(bin,v,8))return parse_error("Invalid binary double");
+        e->_double.type=JSON_DOUBLE;
+        e->_double.d=json_binary_double(bin,v);
+        return NULL;
+    case JSON_NULL:
+    case JSON_TRUE:
+    case JSON_FALSE:
+        e->type=json_binary_type(bin,v);
+        return NULL;
+    default:
+        return parse_error("Invalid binary node at offset %lu",(unsigned long)v);
+    }
+}
+
+static bool node_seen(uint8_t * seen,JSON_Binary_Value v){//marks v, returns true if it was already marked
+    uint8_t bit=1u<<((v>>3)&7);
+    bool was=(seen[v>>6]&bit)!=0;
+    seen[v>>6]|=bit;
+    return was;
+}
+
+static JSON_Element * read_element(const JSON_Binary * bin,JSON_Binary_Value v){
+    JSON_Element * root=calloc(1,sizeof(JSON_Element));
+    uint8_t * seen=calloc((bin->size>>6)+1,1);//one bit per 8-byte aligned offset
+    if(!root||!seen){
+        OOM_EXIT();
+    }
+    root->type=JSON_NULL;
+    read_frame * stack=NULL;
+    size_t depth=0,alloc=0;
+    JSON_Element * err=read_node(bin,v,root);
+    if(!err) node_seen(seen,v);
+    JSON_Element * e=root;
+    while(!err){
+        if(e&&(e->type==JSON_ARRAY||e->type==JSON_OBJECT)){
+            if(depth==JSON_BINARY_MAX_DEPTH){
+                err=parse_error("Binary json nested deeper than %d levels",JSON_BINARY_MAX_DEPTH);
+                break;
+            }
+            if(depth==alloc){
+                alloc=alloc?alloc*2:16;//growth factor 2
+                stack=realloc(stack,alloc*sizeof(read_frame));
+                if(!stack){
+                    OOM_EXIT();
+                }
+            }
+            stack[depth++]=(read_frame){.v=v,.e=e,.index=0,.count=json_binary_size(bin,v)};
+        }
+        if(!depth)break;
+        read_frame * f=&stack[depth-1];
+        if(f->index==f->count){
+            depth--;
+            e=NULL;
+            continue;
+        }
+        size_t i=f->index++;
+        if(f->e->type==JSON_ARRAY){
+            v=json_binary_array_get(bin,f->v,i);
+            e=json_array_emplace(&f->e->_arr);
+        }else{
+            size_t len;
+            const char * key=json_binary_object_key(bin,f->v,i,&len);
+            if(!key){
+                err=parse_error("Invalid binary object key");
+                break;
+            }
+            v=json_binary_object_value(bin,f->v,i);
+            e=json_object_emplace_n(&f->e->_obj,key,len);
+        }
+        err=read_node(bin,v,e);
+        if(!err&&node_seen(seen,v)){
+            err=parse_error("Binary node at offset %lu is used more than once",(unsigned long)v);
+        }
+    }
+    free(stack);
+    free(seen);
+    if(err){
+        json_free_element(root);
+        return err;
+    }
+    return root;
+}
+
+JSON_Element * json_read_binary(const void * data,size_t size){
+    JSON_Binary bin;
+    if(json_binary_open(&bin,data,size)){
+        return parse_error("Invalid binary json header");
+    }
+    return read_element(&bin,json_binary_root(&bin));
+}
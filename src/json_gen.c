@@ -0,0 +1,271 @@
+#include "json_gen.h"
+#include "json_internal.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+#define GEN_FLUSH_SIZE (64*1024)//output is handed to the sink once the buffer reaches this size
+#define GEN_STRING_SLICE (16*1024)//long strings are escaped a slice at a time so the buffer doesn't grow with them
+
+#define GEN_OBJECT 0x1
+#define GEN_HAS_ITEMS 0x2
+
+struct JSON_Gen {
+    uint32_t flags;
+    JSON_Gen_Sink sink;
+    void * ctx;
+    write_buffer buf;
+    uint8_t * stack;//GEN_* bits for each open container
+    size_t depth;
+    size_t stack_alloc;
+    bool after_key;//a key was written, its value comes next
+    bool complete;//the top-level value is done
+    JSON_Gen_Error error;
+};
+
+bool json_gen_file_sink(void * f,const char * data,size_t n){
+    return fwrite(data,1,n,f)==n;
+}
+
+JSON_Gen * json_make_gen(uint32_t flags,JSON_Gen_Sink sink,void * ctx){
+    JSON_Gen * gen=calloc(1,sizeof(JSON_Gen));
+    if(!gen)OOM_EXIT();
+    gen->flags=flags;
+    gen->sink=sink;
+    gen->ctx=ctx;
+    return gen;
+}
+
+void json_free_gen(JSON_Gen * gen){
+    if(!gen)return;
+    free(gen->buf.s);
+    free(gen->stack);
+    free(gen);
+}
+
+JSON_Gen_Error json_gen_error(const JSON_Gen * gen){
+    return gen->error;
+}
+
+const char * json_gen_buffer(const JSON_Gen * gen,size_t * len){
+    *len=gen->buf.len;
+    return gen->buf.s;
+}
+
+static bool fail(JSON_Gen * gen,JSON_Gen_Error error){
+    if(!gen->error)gen->error=error;
+    return false;
+}
+
+static bool flush(JSON_Gen * gen){
+    if(!gen->sink||!gen->buf.len)return true;
+    bool ok=gen->sink(gen->ctx,gen->buf.s,gen->buf.len);
+    gen->buf.len=0;
+    return ok||fail(gen,JSON_GEN_SINK_FAILED);
+}
+
+static bool maybe_flush(JSON_Gen * gen){
+    return gen->buf.len<GEN_FLUSH_SIZE||flush(gen);
+}
+
+static void indent(JSON_Gen * gen,size_t depth){
+    write_reserve(&gen->buf,depth*2);
+    memset(gen->buf.s+gen->buf.len,' ',depth*2);
+    gen->buf.len+=depth*2;
+}
+
+static void separator(JSON_Gen * gen){//before an array item or an object key
+    uint8_t * top=&gen->stack[gen->depth-1];
+    if(*top&GEN_HAS_ITEMS)write_putc(&gen->buf,',');
+    *top|=GEN_HAS_ITEMS;
+    if(gen->flags&JSON_GEN_PRETTY){
+        write_putc(&gen->buf,'\n');
+        indent(gen,gen->depth);
+    }
+}
+
+static bool value_allowed(JSON_Gen * gen){//checks a value can go here, without writing anything
+    if(gen->error)return false;
+    if(gen->depth==0){
+        return !gen->complete||fail(gen,JSON_GEN_MISPLACED);
+    }
+    if(gen->stack[gen->depth-1]&GEN_OBJECT){
+        return gen->after_key||fail(gen,JSON_GEN_MISPLACED);
+    }
+    return true;
+}
+
+static bool begin_value(JSON_Gen * gen){
+    if(!value_allowed(gen))return false;
+    if(gen->depth==0)return true;
+    if(gen->stack[gen->depth-1]&GEN_OBJECT){
+        gen->after_key=false;
+        return true;
+    }
+    separator(gen);
+    return true;
+}
+
+static bool end_value(JSON_Gen * gen){
+    if(gen->depth==0)gen->complete=true;
+    return maybe_flush(gen);
+}
+
+static bool quoted(JSON_Gen * gen,const char * s,size_t n){
+    write_putc(&gen->buf,'"');
+    while(n>GEN_STRING_SLICE&&gen->sink){
+        write_escaped(&gen->buf,s,GEN_STRING_SLICE);
+        s+=GEN_STRING_SLICE;
+        n-=GEN_STRING_SLICE;
+        if(!maybe_flush(gen))return false;
+    }
+    write_escaped(&gen->buf,s,n);
+    write_putc(&gen->buf,'"');
+    return true;
+}
+
+static bool begin(JSON_Gen * gen,uint8_t kind,char c){
+    if(!begin_value(gen))return false;
+    if(gen->depth==gen->stack_alloc){
+        gen->stack_alloc=gen->stack_alloc?gen->stack_alloc*2:16;
+        gen->stack=realloc(gen->stack,gen->stack_alloc);
+        if(!gen->stack)OOM_EXIT();
+    }
+    gen->stack[gen->depth++]=kind;
+    write_putc(&gen->buf,c);
+    return true;
+}
+
+static bool end(JSON_Gen * gen,uint8_t kind,char c){
+    if(gen->error)return false;
+    if(gen->depth==0||(gen->stack[gen->depth-1]&GEN_OBJECT)!=kind||gen->after_key){
+        return fail(gen,JSON_GEN_MISPLACED);
+    }
+    gen->depth--;
+    if((gen->flags&JSON_GEN_PRETTY)&&(gen->stack[gen->depth]&GEN_HAS_ITEMS)){
+        write_putc(&gen->buf,'\n');
+        indent(gen,gen->depth);
+    }
+    write_putc(&gen->buf,c);
+    return end_value(gen);
+}
+
+bool json_gen_begin_object(JSON_Gen * gen){
+    return begin(gen,GEN_OBJECT,'{');
+}
+
+bool json_gen_end_object(JSON_Gen * gen){
+    return end(gen,GEN_OBJECT,'}');
+}
+
+bool json_gen_begin_array(JSON_Gen * gen){
+    return begin(gen,0,'[');
+}
+
+bool json_gen_end_array(JSON_Gen * gen){
+    return end(gen,0,']');
+}
+
+bool json_gen_key(JSON_Gen * gen,const char * key){
+    return json_gen_key_n(gen,key,strlen(key));
+}
+
+bool json_gen_key_n(JSON_Gen * gen,const char * key,size_t n){
+    if(gen->error)return false;
+    if(gen->depth==0||!(gen->stack[gen->depth-1]&GEN_OBJECT)||gen->after_key){
+        return fail(gen,JSON_GEN_MISPLACED);
+    }
+    separator(gen);
+    if(!quoted(gen,key,n))return false;
+    write_putc(&gen->buf,':');
+    gen->after_key=true;
+    return true;
+}
+
+bool json_gen_null(JSON_Gen * gen){
+    if(!begin_value(gen))return false;
+    write_put(&gen->buf,"null",4);
+    return end_value(gen);
+}
+
+bool json_gen_bool(JSON_Gen * gen,bool b){
+    if(!begin_value(gen))return false;
+    if(b){
+        write_put(&gen->buf,"true",4);
+    }else{
+        write_put(&gen->buf,"false",5);
+    }
+    return end_value(gen);
+}
+
+bool json_gen_int(JSON_Gen * gen,int64_t i){
+    if(!begin_value(gen))return false;
+    write_integer(&gen->buf,i);
+    return end_value(gen);
+}
+
+bool json_gen_double(JSON_Gen * gen,double d){
+    if(!value_allowed(gen))return false;//a misplaced nan is reported as misplaced
+    if(!isfinite(d))return fail(gen,JSON_GEN_INVALID_NUMBER);
+    if(!begin_value(gen))return false;
+    write_double(&gen->buf,d);
+    return end_value(gen);
+}
+
+bool json_gen_string(JSON_Gen * gen,const char * s){
+    return json_gen_string_n(gen,s,strlen(s));
+}
+
+bool json_gen_string_n(JSON_Gen * gen,const char * s,size_t n){
+    if(!begin_value(gen))return false;
+    if(!quoted(gen,s,n))return false;
+    return end_value(gen);
+}
+
+bool json_gen_element(JSON_Gen * gen,JSON_Element * elem){
+    switch(elem->type){
+    case JSON_ARRAY:
+        if(!json_gen_begin_array(gen))return false;
+        for(size_t i=0;i<elem->_arr.size;i++){
+            JSON_Element tmp;
+            if(!json_gen_element(gen,json_array_item(&elem->_arr,i,&tmp)))return false;
+        }
+        return json_gen_end_array(gen);
+    case JSON_OBJECT:{
+            if(!json_gen_begin_object(gen))return false;
+            JSON_Object_Iterator it={0};
+            const char * key;
+            size_t len;
+            JSON_Element * value;
+            while(json_object_next_n(&elem->_obj,&it,&key,&len,&value)){
+                if(!json_gen_key_n(gen,key,len)||!json_gen_element(gen,value))return false;
+            }
+            return json_gen_end_object(gen);
+        }
+    case JSON_STRING:
+        return json_gen_string_n(gen,json_string_data(&elem->_str),json_string_length(&elem->_str));
+    case JSON_INTEGER:
+        return json_gen_int(gen,elem->_int.i);
+    case JSON_DOUBLE:
+        return json_gen_double(gen,elem->_double.d);
+    case JSON_TRUE:
+        return json_gen_bool(gen,true);
+    case JSON_FALSE:
+        return json_gen_bool(gen,false);
+    case JSON_NULL:
+        return json_gen_null(gen);
+    case JSON_PARSE_ERROR://not a value
+        break;
+    }
+    return fail(gen,JSON_GEN_MISPLACED);
+}
+
+bool json_gen_finish(JSON_Gen * gen){
+    if(gen->error)return false;
+    if(!gen->complete)return fail(gen,JSON_GEN_MISPLACED);
+    return flush(gen);
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "json.h"
+#include "json_lexer.h"
+#include <stdbool.h>
+#include <string.h>
+
+//declarations shared between the library's translation units, not part of the public api
+
+#define OOM_EXIT() err_exit("Out of Memory in %s",__func__)
+
+JSON_Element * parse_error(const char * fmt,...);
+
+JSON_Element * json_error_element(const JSON_Error * error);//JSON_PARSE_ERROR element with the json_error_message text
+
+//object layout, entries are kept in per-bucket arrays that are reallocated as they grow
+
+typedef struct JSON_Object_Table_Elem {
+    uint32_t size;
+    uint32_t alloc;
+    void * arr;
+} JSON_Object_Table_Elem;
+
+typedef struct JSON_Object_Table {
+    size_t refs;//see json_ref_acquire
+    uint32_t num_buckets;
+    uint32_t item_size;
+    JSON_Object_Table_Elem buckets[];
+} JSON_Object_Table;
+
+#define JSON_OBJECT_BUCKETS 32
+
+typedef struct JSON_ObjectEntry {
+    char * key;
+    size_t len;
+    JSON_Element elem;
+} JSON_ObjectEntry;
+
+uint32_t json_key_hash(const char * key);//hash used by object tables
+uint32_t json_key_hash_n(const char * key,size_t n);
+
+JSON_Element * json_object_get_hashed(JSON_Object * obj,const char * key,size_t n,uint32_t hash);//key doesn't need to be null-terminated, hash must be json_key_hash of the key
+
+//arrays and object tables are shared between the copies made by json_clone, and copied on write
+//refs counts the elements pointing to the block, 0 means it isn't counted (arena documents, see json_parser.h), and json_clone copies it instead
+//counts change with atomics, so copies can be cloned and freed from different threads
+
+static inline bool json_ref_acquire(size_t * refs){//returns false if the block isn't counted, and has to be copied instead
+    if(!__atomic_load_n(refs,__ATOMIC_RELAXED))return false;
+    __atomic_add_fetch(refs,1,__ATOMIC_RELAXED);
+    return true;
+}
+
+static inline bool json_ref_release(size_t * refs){//returns true if that was the last reference, and the block should be freed
+    return __atomic_load_n(refs,__ATOMIC_RELAXED)&&__atomic_sub_fetch(refs,1,__ATOMIC_ACQ_REL)==0;
+}
+
+static inline bool json_ref_shared(size_t * refs){//true if the block must be copied before it's modified
+    return __atomic_load_n(refs,__ATOMIC_ACQUIRE)>1;
+}
+
+//arrays keep their reference count and capacity in two size_t right before arr[0]
+
+#define JSON_ARRAY_HEADER 2
+
+static inline size_t * json_array_block(const JSON_Array * arr){
+    return (size_t*)arr->arr-JSON_ARRAY_HEADER;
+}
+
+static inline size_t json_array_capacity(const JSON_Array * arr){
+    return arr->arr?((const size_t*)arr->arr)[-1]:0;
+}
+
+JSON_Element * json_array_alloc(size_t capacity);//returns uninitialized storage for capacity elements with one reference, to be set as arr->arr
+
+char * json_init_string_buffer(JSON_String * str,size_t n);//initializes a string of length n in place, returns the buffer to write its n chars to, already null-terminated
+
+//output buffer for the writers that don't go through a FILE* (json_parallel.c, json_gen.c), same text as json_write_element
+
+typedef struct write_buffer {
+    char * s;
+    size_t len;
+    size_t alloc;
+} write_buffer;
+
+void write_grow(write_buffer * b,size_t n);//makes room for n more chars
+
+static inline void write_reserve(write_buffer * b,size_t n){
+    if(b->len+n>b->alloc)write_grow(b,n);
+}
+
+static inline void write_put(write_buffer * b,const char * s,size_t n){
+    write_reserve(b,n);
+    memcpy(b->s+b->len,s,n);
+    b->len+=n;
+}
+
+static inline void write_putc(write_buffer * b,char c){
+    write_reserve(b,1);
+    b->s[b->len++]=c;
+}
+
+void write_escaped(write_buffer * b,const char * str,size_t len);//str with the escapes of json_write_string, without the quotes
+
+void write_integer(write_buffer * b,int64_t i);
+
+void write_double(write_buffer * b,double d);
+
+void write_packed_items(write_buffer * b,JSON_Array * arr,size_t first,size_t count,size_t indentation);//items [first,first+count) of a packed array with their separators, same layout as json_write_array
+
+//moving elements around without copying them
+
+JSON_Element * json_take(JSON_Element * elem);//moves the contents of elem into a new element, leaving elem as JSON_NULL
+
+void json_replace(JSON_Element * dst,JSON_Element * src);//frees the contents of dst and moves src into it, src pointer is invalidated
+
+JSON_Element * json_object_take_n(JSON_Object * obj,const char * key,size_t n);//removes the entry without freeing its element, returns NULL if not found
+
+JSON_Element * json_array_take(JSON_Array * arr,size_t index);//removes the entry without freeing its element, returns NULL if not found
+
+//JSON Pointer helpers (json_path.c)
+
+bool pointer_index(const char * token,size_t len,size_t * index);//parses an unescaped token as an array index, returns false if it isn't one
+
+size_t pointer_unescape_token(const char * token,size_t n,char * out);//out must hold n+1 chars, returns the unescaped length or SIZE_MAX if token is invalid
+
+typedef struct pointer_buffer {
+    char * s;
+    size_t len;
+    size_t alloc;
+} pointer_buffer;
+
+void pointer_reserve(pointer_buffer * p,size_t n);
+
+void pointer_push_key_n(pointer_buffer * p,const char * key,size_t n);//appends an escaped token, restore by resetting len
+
+void pointer_push_index(pointer_buffer * p,size_t index);
@@ -0,0 +1,456 @@
+#define _POSIX_C_SOURCE 200809L
+#include "json_parallel.h"
+#include "json_internal.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#define CHUNK_ITEMS 1024//most items in one chunk, so huge containers are split into more chunks than threads
+#define PARTS_PER_THREAD 4//chunks per thread a document is split into, at least
+#define WINDOW_PER_THREAD 4//segments per thread that may be serialized ahead of the one being written
+#define MAX_IOV 64
+
+typedef enum segment_kind {
+    SEGMENT_LITERAL,//text produced while splitting the document, already in buf
+    SEGMENT_ELEMENT,//a whole element
+    SEGMENT_ITEMS,//count consecutive items of a container, with their separators
+} segment_kind;
+
+typedef struct write_segment {
+    segment_kind kind;
+    bool done;
+    JSON_Element * elem;
+    size_t indentation;//of elem
+    size_t first;//position of the first item in the container
+    uint32_t bucket;//objects: where the first item is in the table
+    uint32_t entry;
+    size_t count;
+    write_buffer buf;
+} write_segment;
+
+struct JSON_Write_Pool {
+    pthread_t * threads;
+    size_t num_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work;//workers wait here for segments
+    pthread_cond_t done;//the writer waits here for the segment it's about to write
+    bool quit;
+    //current document, segments from next up to limit can be picked up by workers
+    write_segment * segs;
+    size_t num_segs;
+    size_t next;
+    size_t limit;
+    size_t active;//segments being serialized
+    //buffers of written segments, reused by the workers
+    write_buffer * spare;
+    size_t spare_size;
+    size_t spare_alloc;
+};
+
+static void buf_indent(write_buffer * b,size_t indentation){
+    write_reserve(b,indentation*2);
+    memset(b->s+b->len,' ',indentation*2);
+    b->len+=indentation*2;
+}
+
+static void buf_quoted(write_buffer * b,const char * str,size_t len){
+    write_putc(b,'"');
+    write_escaped(b,str,len);
+    write_putc(b,'"');
+}
+
+static void buf_element(write_buffer * b,JSON_Element * elem,size_t indentation);
+
+static void buf_item_prefix(write_buffer * b,size_t pos,size_t indentation){
+    if(pos==0){
+        write_putc(b,'\n');
+    }else{
+        write_put(b,",\n",2);
+    }
+    buf_indent(b,indentation+1);
+}
+
+//items [first,first+count) of a container, each with its separator and indentation, same layout as json_write_array/json_write_object
+static void buf_items(write_buffer * b,write_segment * seg){
+    JSON_Element * elem=seg->elem;
+    size_t indentation=seg->indentation;
+    if(elem->_arr.type==JSON_ARRAY&&elem->_arr.packed){
+        write_packed_items(b,&elem->_arr,seg->first,seg->count,indentation);
+    }else if(elem->type==JSON_ARRAY){
+        JSON_Element * a=elem->_arr.arr;
+        for(size_t i=seg->first;i<seg->first+seg->count;i++){
+            buf_item_prefix(b,i,indentation);
+            buf_element(b,&a[i],indentation+1);
+        }
+    }else{
+        JSON_Object_Table * tbl=elem->_obj.tbl;
+        uint32_t i=seg->bucket;
+        uint32_t j=seg->entry;
+        for(size_t k=0;k<seg->count;k++){
+            while(j>=tbl->buckets[i].size||!tbl->buckets[i].arr){
+                i++;
+                j=0;
+            }
+            JSON_ObjectEntry * entry=&((JSON_ObjectEntry*)tbl->buckets[i].arr)[j++];
+            buf_item_prefix(b,seg->first+k,indentation);
+            buf_quoted(b,entry->key,entry->len);
+            write_putc(b,':');
+            buf_element(b,&entry->elem,indentation+1);
+        }
+    }
+}
+
+static size_t container_size(JSON_Element * elem){
+    if(elem->type==JSON_ARRAY){
+        return elem->_arr.arr?elem->_arr.size:0;
+    }
+    size_t n=0;
+    for(uint32_t i=0;i<elem->_obj.tbl->num_buckets;i++){
+        if(elem->_obj.tbl->buckets[i].arr)n+=elem->_obj.tbl->buckets[i].size;
+    }
+    return n;
+}
+
+static void buf_container_close(write_buffer * b,JSON_Element * elem,size_t size,size_t indentation){
+    char c=elem->type==JSON_ARRAY?']':'}';
+    if(size){
+        write_putc(b,'\n');
+        buf_indent(b,indentation);
+    }
+    write_putc(b,c);
+}
+
+static void buf_element(write_buffer * b,JSON_Element * elem,size_t indentation){
+    switch(elem->type){
+    case JSON_ARRAY:
+    case JSON_OBJECT:{
+            write_segment seg={.elem=elem,.indentation=indentation,.count=container_size(elem)};
+            write_putc(b,elem->type==JSON_ARRAY?'[':'{');
+            buf_items(b,&seg);
+            buf_container_close(b,elem,seg.count,indentation);
+        }
+        break;
+    case JSON_STRING:
+        buf_quoted(b,json_string_data(&elem->_str),json_string_length(&elem->_str));
+        break;
+    case JSON_INTEGER:
+        write_integer(b,elem->_int.i);
+        break;
+    case JSON_DOUBLE:
+        write_double(b,elem->_double.d);
+        break;
+    case JSON_TRUE:
+        write_put(b,"true",4);
+        break;
+    case JSON_FALSE:
+        write_put(b,"false",5);
+        break;
+    case JSON_NULL:
+        write_put(b,"null",4);
+        break;
+    case JSON_PARSE_ERROR:
+        write_put(b,"PARSE ERROR: ",13);
+        write_put(b,json_string_data(&elem->_str),strlen(json_string_data(&elem->_str)));
+        break;
+    }
+}
+
+//splitting the document into segments
+
+typedef struct segment_list {
+    write_segment * segs;
+    size_t size;
+    size_t alloc;
+} segment_list;
+
+static write_segment * push_segment(segment_list * list,segment_kind kind){
+    if(list->size==list->alloc){
+        list->alloc=list->alloc?list->alloc*2:64;
+        list->segs=realloc(list->segs,list->alloc*sizeof(write_segment));
+        if(!list->segs)OOM_EXIT();
+    }
+    write_segment * seg=&list->segs[list->size++];
+    memset(seg,0,sizeof(write_segment));
+    seg->kind=kind;
+    return seg;
+}
+
+static write_buffer * literal(segment_list * list){//buffer to append literal text to
+    if(!list->size||list->segs[list->size-1].kind!=SEGMENT_LITERAL){
+        push_segment(list,SEGMENT_LITERAL)->done=true;
+    }
+    return &list->segs[list->size-1].buf;
+}
+
+//splits elem into about parts segments, containers with fewer items than parts split their share among their children
+//sizes of subtrees aren't known, so a big child next to small siblings only gets an equal share
+static void split(segment_list * list,JSON_Element * elem,size_t indentation,size_t parts){
+    if(elem->type!=JSON_ARRAY&&elem->type!=JSON_OBJECT){
+        buf_element(literal(list),elem,indentation);
+        return;
+    }
+    size_t size=container_size(elem);
+    if(parts<=1||size==0){
+        write_segment * seg=push_segment(list,SEGMENT_ELEMENT);
+        seg->elem=elem;
+        seg->indentation=indentation;
+        return;
+    }
+    write_putc(literal(list),elem->type==JSON_ARRAY?'[':'{');
+    if(size>=parts){
+        size_t chunks=parts;
+        if(size/CHUNK_ITEMS>chunks)chunks=size/CHUNK_ITEMS;
+        size_t per_chunk=(size+chunks-1)/chunks;
+        if(elem->type==JSON_ARRAY){
+            for(size_t i=0;i<size;i+=per_chunk){
+                write_segment * seg=push_segment(list,SEGMENT_ITEMS);
+                seg->elem=elem;
+                seg->indentation=indentation;
+                seg->first=i;
+                seg->count=size-i<per_chunk?size-i:per_chunk;
+            }
+        }else{
+            JSON_Object_Table * tbl=elem->_obj.tbl;
+            size_t pos=0;
+            write_segment * seg=NULL;
+            for(uint32_t i=0;i<tbl->num_buckets;i++){
+                if(!tbl->buckets[i].arr)continue;
+                for(uint32_t j=0;j<tbl->buckets[i].size;j++,pos++){
+                    if(pos%per_chunk==0){
+                        seg=push_segment(list,SEGMENT_ITEMS);
+                        seg->elem=elem;
+                        seg->indentation=indentation;
+                        seg->first=pos;
+                        seg->bucket=i;
+                        seg->entry=j;
+                    }
+                    seg->count++;
+                }
+            }
+        }
+    }else{
+        size_t child_parts=parts/size;
+        if(elem->type==JSON_ARRAY){
+            for(size_t i=0;i<size;i++){
+                buf_item_prefix(literal(list),i,indentation);
+                JSON_Element tmp;
+                split(list,json_array_item(&elem->_arr,i,&tmp),indentation+1,child_parts);
+            }
+        }else{
+            JSON_Object_Table * tbl=elem->_obj.tbl;
+            size_t pos=0;
+            for(uint32_t i=0;i<tbl->num_buckets;i++){
+                if(!tbl->buckets[i].arr)continue;
+                for(uint32_t j=0;j<tbl->buckets[i].size;j++,pos++){
+                    JSON_ObjectEntry * entry=&((JSON_ObjectEntry*)tbl->buckets[i].arr)[j];
+                    write_buffer * b=literal(list);
+                    buf_item_prefix(b,pos,indentation);
+                    buf_quoted(b,entry->key,entry->len);
+                    write_putc(b,':');
+                    split(list,&entry->elem,indentation+1,child_parts);
+                }
+            }
+        }
+    }
+    buf_container_close(literal(list),elem,size,indentation);
+}
+
+//worker pool
+
+static void * worker(void * arg){
+    JSON_Write_Pool * pool=arg;
+    pthread_mutex_lock(&pool->lock);
+    for(;;){
+        while(pool->segs&&pool->next<pool->num_segs&&pool->segs[pool->next].kind==SEGMENT_LITERAL){
+            pool->next++;
+        }
+        if(pool->quit)break;
+        if(!pool->segs||pool->next>=pool->num_segs||pool->next>=pool->limit){
+            pthread_cond_wait(&pool->work,&pool->lock);
+            continue;
+        }
+        write_segment * seg=&pool->segs[pool->next++];
+        write_buffer b={0};
+        if(pool->spare_size)b=pool->spare[--pool->spare_size];
+        pool->active++;
+        pthread_mutex_unlock(&pool->lock);
+        if(seg->kind==SEGMENT_ELEMENT){
+            buf_element(&b,seg->elem,seg->indentation);
+        }else{
+            buf_items(&b,seg);
+        }
+        pthread_mutex_lock(&pool->lock);
+        seg->buf=b;
+        seg->done=true;
+        pool->active--;
+        pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+JSON_Write_Pool * json_make_write_pool(size_t threads){
+    if(!threads){
+        long n=sysconf(_SC_NPROCESSORS_ONLN);
+        threads=n>0?n:1;
+    }
+    JSON_Write_Pool * pool=calloc(1,sizeof(JSON_Write_Pool));
+    if(!pool)OOM_EXIT();
+    pool->threads=calloc(threads,sizeof(pthread_t));
+    if(!pool->threads)OOM_EXIT();
+    pthread_mutex_init(&pool->lock,NULL);
+    pthread_cond_init(&pool->work,NULL);
+    pthread_cond_init(&pool->done,NULL);
+    for(size_t i=0;i<threads;i++){
+        if(pthread_create(&pool->threads[i],NULL,worker,pool)!=0){
+            if(i==0)err_exit("Couldn't start writer threads in %s",__func__);
+            break;
+        }
+        pool->num_threads++;
+    }
+    return pool;
+}
+
+void json_free_write_pool(JSON_Write_Pool * pool){
+    if(!pool)return;
+    pthread_mutex_lock(&pool->lock);
+    pool->quit=true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for(size_t i=0;i<pool->num_threads;i++){
+        pthread_join(pool->threads[i],NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->done);
+    for(size_t i=0;i<pool->spare_size;i++){
+        free(pool->spare[i].s);
+    }
+    free(pool->spare);
+    free(pool->threads);
+    free(pool);
+}
+
+//writing segments out in order
+
+typedef struct write_target {
+    FILE * f;
+    int fd;
+} write_target;
+
+static bool write_fd(int fd,struct iovec * iov,int n){
+    while(n>0){
+        ssize_t w=writev(fd,iov,n);
+        if(w<0){
+            if(errno==EINTR)continue;
+            return false;
+        }
+        while(n>0&&(size_t)w>=iov->iov_len){
+            w-=iov->iov_len;
+            iov++;
+            n--;
+        }
+        if(n>0){
+            iov->iov_base=(char*)iov->iov_base+w;
+            iov->iov_len-=w;
+        }
+    }
+    return true;
+}
+
+static bool write_segments(write_target * target,write_segment * segs,size_t n){
+    if(target->f){
+        for(size_t i=0;i<n;i++){
+            if(segs[i].buf.len&&fwrite(segs[i].buf.s,1,segs[i].buf.len,target->f)!=segs[i].buf.len)return false;
+        }
+        return true;
+    }
+    struct iovec iov[MAX_IOV];
+    int k=0;
+    for(size_t i=0;i<n;i++){
+        if(!segs[i].buf.len)continue;
+        iov[k].iov_base=segs[i].buf.s;
+        iov[k].iov_len=segs[i].buf.len;
+        k++;
+    }
+    return write_fd(target->fd,iov,k);
+}
+
+static void recycle(JSON_Write_Pool * pool,write_buffer * b){//pool must be locked
+    if(b->s&&pool->spare_size<pool->num_threads*WINDOW_PER_THREAD){
+        if(pool->spare_size==pool->spare_alloc){
+            pool->spare_alloc=pool->spare_alloc?pool->spare_alloc*2:8;
+            pool->spare=realloc(pool->spare,pool->spare_alloc*sizeof(write_buffer));
+            if(!pool->spare)OOM_EXIT();
+        }
+        b->len=0;
+        pool->spare[pool->spare_size++]=*b;
+    }else{
+        free(b->s);
+    }
+    b->s=NULL;
+}
+
+static bool write_parallel(JSON_Write_Pool * pool,write_target * target,JSON_Element * elem,size_t indentation){
+    segment_list list={0};
+    split(&list,elem,indentation,pool->num_threads*PARTS_PER_THREAD);
+    size_t window=pool->num_threads*WINDOW_PER_THREAD;
+    pthread_mutex_lock(&pool->lock);
+    pool->segs=list.segs;
+    pool->num_segs=list.size;
+    pool->next=0;
+    pool->limit=window;
+    pthread_cond_broadcast(&pool->work);
+    bool ok=true;
+    size_t written=0;
+    while(written<list.size){
+        while(!list.segs[written].done){
+            pthread_cond_wait(&pool->done,&pool->lock);
+        }
+        size_t end=written+1;
+        while(end<list.size&&end-written<MAX_IOV&&list.segs[end].done)end++;
+        pthread_mutex_unlock(&pool->lock);
+        if(ok&&!write_segments(target,list.segs+written,end-written)){
+            ok=false;
+        }
+        pthread_mutex_lock(&pool->lock);
+        for(size_t i=written;i<end;i++){
+            recycle(pool,&list.segs[i].buf);
+        }
+        written=end;
+        if(!ok){//stop handing out segments, and wait for the ones already started
+            pool->next=list.size;
+            while(pool->active){
+                pthread_cond_wait(&pool->done,&pool->lock);
+            }
+            for(size_t i=written;i<list.size;i++){
+                free(list.segs[i].buf.s);
+            }
+            break;
+        }
+        pool->limit=written+window;
+        pthread_cond_broadcast(&pool->work);
+    }
+    pool->segs=NULL;
+    pool->num_segs=0;
+    pthread_mutex_unlock(&pool->lock);
+    free(list.segs);
+    return ok;
+}
+
+bool json_write_element_parallel(JSON_Write_Pool * pool,FILE * f,JSON_Element * elem,size_t indentation){
+    write_target target={f,-1};
+    return write_parallel(pool,&target,elem,indentation)&&!ferror(f);
+}
+
+bool json_write_element_fd(JSON_Write_Pool * pool,int fd,JSON_Element * elem,size_t indentation){
+    write_target target={NULL,fd};
+    return write_parallel(pool,&target,elem,indentation);
+}
@@ -0,0 +1,454 @@
+#include "json_parser.h"
+#include "json_internal.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_CHUNK_SIZE (64*1024)
+#define ARENA_ALIGN 8
+#define INTERN_CHUNK_SIZE (4*1024)
+
+typedef struct arena_chunk {
+    struct arena_chunk * next;
+    size_t size;
+    size_t used;
+    uint64_t data[];
+} arena_chunk;
+
+typedef struct intern_chunk {
+    struct intern_chunk * next;
+    size_t used;
+    char data[INTERN_CHUNK_SIZE];
+} intern_chunk;
+
+typedef struct intern_slot {
+    char * key;//NULL if the slot is empty
+    size_t len;
+    uint32_t hash;
+} intern_slot;
+
+typedef struct parser_frame {
+    size_t vals_start;
+    size_t keys_start;
+    bool is_object;
+} parser_frame;
+
+typedef struct parser_key {
+    char * key;
+    size_t len;
+    uint32_t hash;
+} parser_key;
+
+struct JSON_Parser {
+    JSON_Parser_Limits limits;
+    JSON_Lexer p;
+    //arena, chunks after current are free and reused before allocating new ones
+    arena_chunk * chunks;
+    arena_chunk * current;
+    arena_chunk * last;
+    size_t arena_size;//total size of the chunks
+    //open containers, and the finished values and keys waiting for their container to close
+    parser_frame * stack;
+    size_t depth;
+    size_t stack_alloc;
+    JSON_Element * vals;
+    size_t vals_size;
+    size_t vals_alloc;
+    parser_key * keys;
+    size_t keys_size;
+    size_t keys_alloc;
+    //keys are unescaped here before being interned
+    char * scratch;
+    size_t scratch_alloc;
+    //interned keys, kept for the lifetime of the parser
+    intern_slot * intern;
+    size_t intern_alloc;//power of 2
+    size_t intern_count;
+    size_t intern_bytes;
+    intern_chunk * intern_chunks;
+};
+
+JSON_Parser * json_make_parser(const JSON_Parser_Limits * limits){
+    JSON_Parser * parser=calloc(1,sizeof(JSON_Parser));
+    if(!parser){
+        OOM_EXIT();
+    }
+    if(limits){
+        parser->limits=*limits;
+    }else{
+        parser->limits.arena=1024*1024;
+        parser->limits.scratch=256*1024;
+        parser->limits.keys=64*1024;
+    }
+    return parser;
+}
+
+void json_free_parser(JSON_Parser * parser){
+    if(!parser)return;
+    for(arena_chunk * c=parser->chunks,* next;c;c=next){
+        next=c->next;
+        free(c);
+    }
+    for(intern_chunk * c=parser->intern_chunks,* next;c;c=next){
+        next=c->next;
+        free(c);
+    }
+    free(parser->stack);
+    free(parser->vals);
+    free(parser->keys);
+    free(parser->scratch);
+    free(parser->intern);
+    free(parser);
+}
+
+static void * arena_alloc(JSON_Parser * parser,size_t n){
+    n=(n+ARENA_ALIGN-1)&~(size_t)(ARENA_ALIGN-1);
+    arena_chunk * c=parser->current;
+    while(c&&c->used+n>c->size){
+        c=c->next;
+        if(c) c->used=0;
+    }
+    if(!c){
+        size_t size=n>ARENA_CHUNK_SIZE?n:ARENA_CHUNK_SIZE;
+        c=malloc(sizeof(arena_chunk)+size);
+        if(!c){
+            OOM_EXIT();
+        }
+        c->next=NULL;
+        c->size=size;
+        c->used=0;
+        if(parser->last){
+            parser->last->next=c;
+        }else{
+            parser->chunks=c;
+        }
+        parser->last=c;
+        parser->arena_size+=size;
+    }
+    parser->current=c;
+    void * ptr=(char*)c->data+c->used;
+    c->used+=n;
+    return ptr;
+}
+
+void json_parser_reset(JSON_Parser * parser){
+    //chunks are rewound, not freed, unless there are more than the limit allows
+    if(parser->arena_size>parser->limits.arena){
+        size_t kept=0;
+        arena_chunk ** link=&parser->chunks;
+        parser->last=NULL;
+        while(*link){
+            arena_chunk * c=*link;
+            if(kept+c->size>parser->limits.arena){
+                *link=c->next;
+                free(c);
+            }else{
+                kept+=c->size;
+                parser->last=c;
+                link=&c->next;
+            }
+        }
+        parser->arena_size=kept;
+    }
+    parser->current=parser->chunks;
+    if(parser->current) parser->current->used=0;
+}
+
+static void * scratch_reserve(void * buf,size_t * alloc,size_t needed,size_t item_size){
+    if(needed<=*alloc)return buf;
+    size_t new_alloc=*alloc?*alloc:16;
+    while(new_alloc<needed)new_alloc*=2;//growth factor 2
+    buf=realloc(buf,new_alloc*item_size);
+    if(!buf){
+        OOM_EXIT();
+    }
+    *alloc=new_alloc;
+    return buf;
+}
+
+static void scratch_trim(void ** buf,size_t * alloc,size_t item_size,size_t limit){
+    if(*alloc*item_size>limit){
+        free(*buf);
+        *buf=NULL;
+        *alloc=0;
+    }
+}
+
+static char * intern_store(JSON_Parser * parser,const char * key,size_t len){
+    intern_chunk * c=parser->intern_chunks;
+    if(!c||c->used+len+1>INTERN_CHUNK_SIZE){
+        c=malloc(sizeof(intern_chunk));
+        if(!c){
+            OOM_EXIT();
+        }
+        c->next=parser->intern_chunks;
+        c->used=0;
+        parser->intern_chunks=c;
+    }
+    char * s=c->data+c->used;
+    memcpy(s,key,len);
+    s[len]=0;
+    c->used+=len+1;
+    parser->intern_bytes+=len+1;
+    return s;
+}
+
+static void intern_grow(JSON_Parser * parser){
+    size_t new_alloc=parser->intern_alloc?parser->intern_alloc*2:256;
+    intern_slot * slots=calloc(new_alloc,sizeof(intern_slot));
+    if(!slots){
+        OOM_EXIT();
+    }
+    for(size_t i=0;i<parser->intern_alloc;i++){
+        intern_slot * s=&parser->intern[i];
+        if(!s->key)continue;
+        size_t j=s->hash&(new_alloc-1);
+        while(slots[j].key)j=(j+1)&(new_alloc-1);
+        slots[j]=*s;
+    }
+    free(parser->intern);
+    parser->intern=slots;
+    parser->intern_alloc=new_alloc;
+}
+
+//returns a stable null-terminated copy of the key, shared by every document the parser builds
+static char * intern_key(JSON_Parser * parser,const char * key,size_t len,uint32_t hash){
+    if(parser->intern_alloc){
+        size_t mask=parser->intern_alloc-1;
+        for(size_t i=hash&mask;parser->intern[i].key;i=(i+1)&mask){
+            intern_slot * s=&parser->intern[i];
+            if(s->hash==hash&&s->len==len&&memcmp(s->key,key,len)==0)return s->key;
+        }
+    }
+    if(parser->intern_bytes+len+1>parser->limits.keys||len>=INTERN_CHUNK_SIZE){
+        char * s=arena_alloc(parser,len+1);
+        memcpy(s,key,len);
+        s[len]=0;
+        return s;
+    }
+    if((parser->intern_count+1)*2>parser->intern_alloc) intern_grow(parser);
+    size_t mask=parser->intern_alloc-1;
+    size_t i=hash&mask;
+    while(parser->intern[i].key)i=(i+1)&mask;
+    intern_slot * s=&parser->intern[i];
+    s->key=intern_store(parser,key,len);
+    s->len=len;
+    s->hash=hash;
+    parser->intern_count++;
+    return s->key;
+}
+
+static JSON_Element * push_value(JSON_Parser * parser){
+    parser->vals=scratch_reserve(parser->vals,&parser->vals_alloc,parser->vals_size+1,sizeof(JSON_Element));
+    JSON_Element * e=&parser->vals[parser->vals_size++];
+    memset(e,0,sizeof(JSON_Element));
+    return e;
+}
+
+static void open_container(JSON_Parser * parser,bool is_object){
+    parser->stack=scratch_reserve(parser->stack,&parser->stack_alloc,parser->depth+1,sizeof(parser_frame));
+    parser_frame * f=&parser->stack[parser->depth++];
+    f->vals_start=parser->vals_size;
+    f->keys_start=parser->keys_size;
+    f->is_object=is_object;
+}
+
+//containers are allocated once their size is known, their values are moved in from the scratch stack
+static void close_container(JSON_Parser * parser){
+    parser_frame * f=&parser->stack[--parser->depth];
+    size_t count=parser->vals_size-f->vals_start;
+    JSON_Element * vals=parser->vals+f->vals_start;
+    JSON_Element result;
+    memset(&result,0,sizeof(result));
+    if(f->is_object){
+        parser_key * keys=parser->keys+f->keys_start;
+        JSON_Object_Table * tbl=arena_alloc(parser,sizeof(JSON_Object_Table)+JSON_OBJECT_BUCKETS*sizeof(JSON_Object_Table_Elem));
+        memset(tbl,0,sizeof(JSON_Object_Table)+JSON_OBJECT_BUCKETS*sizeof(JSON_Object_Table_Elem));//refs 0, arena tables aren't counted
+        tbl->num_buckets=JSON_OBJECT_BUCKETS;
+        tbl->item_size=sizeof(JSON_ObjectEntry);
+        if(count){
+            JSON_ObjectEntry * entries=arena_alloc(parser,count*sizeof(JSON_ObjectEntry));
+            for(size_t i=0;i<count;i++){
+                tbl->buckets[keys[i].hash%JSON_OBJECT_BUCKETS].alloc++;
+            }
+            for(uint32_t b=0;b<JSON_OBJECT_BUCKETS;b++){
+                if(tbl->buckets[b].alloc){
+                    tbl->buckets[b].arr=entries;
+                    entries+=tbl->buckets[b].alloc;
+                }
+            }
+            for(size_t i=0;i<count;i++){
+                JSON_Object_Table_Elem * b=&tbl->buckets[keys[i].hash%JSON_OBJECT_BUCKETS];
+                JSON_ObjectEntry * arr=b->arr;
+                uint32_t j=0;
+                //duplicate keys keep the first position and the last value, same as json_object_set
+                while(j<b->size&&!(arr[j].len==keys[i].len&&memcmp(arr[j].key,keys[i].key,keys[i].len)==0))j++;
+                if(j==b->size){
+                    arr[j].key=keys[i].key;
+                    arr[j].len=keys[i].len;
+                    b->size++;
+                }
+                arr[j].elem=vals[i];
+            }
+        }
+        result._obj.type=JSON_OBJECT;
+        result._obj.tbl=tbl;
+    }else{
+        result._arr.type=JSON_ARRAY;
+        result._arr.size=count;
+        if(count){
+            //same layout as json_array_alloc, with a reference count of 0 (not counted) and the capacity in front
+            size_t * block=arena_alloc(parser,JSON_ARRAY_HEADER*sizeof(size_t)+count*sizeof(JSON_Element));
+            block[0]=0;
+            block[1]=count;
+            result._arr.arr=(JSON_Element*)(block+JSON_ARRAY_HEADER);
+            memcpy(result._arr.arr,vals,count*sizeof(JSON_Element));
+        }
+    }
+    parser->vals_size=f->vals_start;
+    parser->keys_size=f->keys_start;
+    *push_value(parser)=result;
+}
+
+static bool parse_key(JSON_Parser * parser){
+    JSON_Lexer * p=&parser->p;
+    size_t n;
+    if(!json_lex_string_length(p,&n))return false;
+    parser->scratch=scratch_reserve(parser->scratch,&parser->scratch_alloc,n+1,1);
+    json_lex_string_copy(p,parser->scratch);
+    parser->scratch[n]=0;
+    uint32_t hash=json_key_hash_n(parser->scratch,n);
+    parser->keys=scratch_reserve(parser->keys,&parser->keys_alloc,parser->keys_size+1,sizeof(parser_key));
+    parser_key * k=&parser->keys[parser->keys_size++];
+    k->key=intern_key(parser,parser->scratch,n,hash);
+    k->len=n;
+    k->hash=hash;
+    return true;
+}
+
+typedef enum parser_state {
+    PARSER_VALUE,
+    PARSER_KEY,
+    PARSER_AFTER_VALUE,
+} parser_state;
+
+static bool parser_run(JSON_Parser * parser){
+    //iterative, so deeply nested documents don't exhaust the stack
+    JSON_Lexer * p=&parser->p;
+    parser_state state=PARSER_VALUE;
+    while(true){
+        switch(state){
+        case PARSER_VALUE:{
+                json_lex_whitespace(p);
+                if(p->i>=p->n) return json_lex_unexpected(p,"JSON Element");
+                char c=p->s[p->i];
+                if(c=='{'||c=='['){
+                    ++p->i;
+                    open_container(parser,c=='{');
+                    json_lex_whitespace(p);
+                    if(p->i<p->n&&p->s[p->i]==(c=='{'?'}':']')){
+                        ++p->i;
+                        close_container(parser);
+                        state=PARSER_AFTER_VALUE;
+                    }else{
+                        state=c=='{'?PARSER_KEY:PARSER_VALUE;
+                    }
+                    break;
+                }else if(c=='"'||c=='\''){
+                    size_t n;
+                    if(!json_lex_string_length(p,&n))return false;
+                    JSON_String * str=&push_value(parser)->_str;
+                    str->type=JSON_STRING;
+                    if(n<=JSON_STRING_INLINE_MAX){
+                        str->small=n;
+                        json_lex_string_copy(p,(char*)str+1);
+                    }else{
+                        str->small=JSON_STRING_HEAP;
+                        str->heap_len=n;
+                        str->heap_str=arena_alloc(parser,n+1);
+                        json_lex_string_copy(p,str->heap_str);
+                        str->heap_str[n]=0;
+                    }
+                }else if((c>='0'&&c<='9')||c=='.'||c=='-'||c=='+'){
+                    JSON_Number number;
+                    bool is_double;
+                    if(!json_lex_number(p,&number,&is_double))return false;
+                    JSON_Element * e=push_value(parser);
+                    if(is_double){
+                        e->_double.type=JSON_DOUBLE;
+                        e->_double.d=number.d;
+                    }else{
+                        e->_int.type=JSON_INTEGER;
+                        e->_int.i=number.i;
+                    }
+                }else{
+                    JSON_Element_Type type=json_lex_literal(p);
+                    if(type==JSON_PARSE_ERROR) return json_lex_unexpected(p,"JSON Element");
+                    push_value(parser)->type=type;
+                }
+                state=PARSER_AFTER_VALUE;
+                break;
+            }
+        case PARSER_KEY:
+            if(!parse_key(parser))return false;
+            json_lex_whitespace(p);
+            if(p->i>=p->n||p->s[p->i]!=':'){
+                return json_lex_unexpected(p,"':'");
+            }
+            ++p->i;
+            state=PARSER_VALUE;
+            break;
+        case PARSER_AFTER_VALUE:{
+                if(!parser->depth) return true;
+                bool is_object=parser->stack[parser->depth-1].is_object;
+                char close=is_object?'}':']';
+                json_lex_whitespace(p);
+                if(p->i>=p->n){
+                    return json_lex_unexpected(p,is_object?"'}'":"']'");
+                }else if(p->s[p->i]==','){
+                    ++p->i;
+                    json_lex_whitespace(p);
+                    if(p->i<p->n&&p->s[p->i]==close){
+                        ++p->i;
+                        close_container(parser);
+                    }else{
+                        state=is_object?PARSER_KEY:PARSER_VALUE;
+                    }
+                }else if(p->s[p->i]==close){
+                    ++p->i;
+                    close_container(parser);
+                }else{
+                    return json_lex_unexpected(p,is_object?"'}'":"']'");
+                }
+                break;
+            }
+        }
+    }
+}
+
+JSON_Element * json_parser_parse_n(JSON_Parser * parser,const char * s,size_t n,uint32_t flags,JSON_Error * error){
+    json_parser_reset(parser);
+    parser->p=(JSON_Lexer){.i=0,.s=s,.n=n,.flags=flags};
+    parser->depth=0;
+    parser->vals_size=0;
+    parser->keys_size=0;
+    JSON_Element * root=NULL;
+    if(parser_run(parser)){
+        root=arena_alloc(parser,sizeof(JSON_Element));
+        *root=parser->vals[0];
+    }
+    if(error) *error=root?(JSON_Error){0}:parser->p.error;
+    //a huge document doesn't get to keep its scratch memory
+    scratch_trim((void**)&parser->stack,&parser->stack_alloc,sizeof(parser_frame),parser->limits.scratch);
+    scratch_trim((void**)&parser->vals,&parser->vals_alloc,sizeof(JSON_Element),parser->limits.scratch);
+    scratch_trim((void**)&parser->keys,&parser->keys_alloc,sizeof(parser_key),parser->limits.scratch);
+    scratch_trim((void**)&parser->scratch,&parser->scratch_alloc,1,parser->limits.scratch);
+    return root;
+}
+
+JSON_Element * json_parser_parse(JSON_Parser * parser,const char * s,uint32_t flags,JSON_Error * error){
+    return json_parser_parse_n(parser,s,strlen(s),flags,error);
+}
@@ -0,0 +1,320 @@
+#include "json_patch.h"
+#include "json_path.h"
+#include "json_internal.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static JSON_Element * make_literal(JSON_Element_Type type){
+    JSON_Element * e=calloc(1,sizeof(JSON_Element));
+    if(!e){
+        OOM_EXIT();
+    }
+    e->type=type;
+    return e;
+}
+
+//merge patch
+
+//values are cloned out of the patch rather than taken, which would modify it, and it may share them with a copy
+//target is modified through json_object_get_mut, so it only copies what it changes of a tree it shares
+
+static void merge_patch(JSON_Element * target,JSON_Element * patch){
+    if(patch->type!=JSON_OBJECT){
+        json_replace(target,json_clone(patch));
+        return;
+    }
+    if(target->type!=JSON_OBJECT){
+        json_replace(target,(JSON_Element*)json_make_object());
+    }
+    JSON_Object_Iterator it={0};
+    const char * key;
+    size_t key_len;
+    JSON_Element * value;
+    while(json_object_next_n(&patch->_obj,&it,&key,&key_len,&value)){
+        if(value->type==JSON_NULL){
+            json_object_remove_n(&target->_obj,key,key_len);
+            continue;
+        }
+        JSON_Element * t=json_object_get_mut_n(&target->_obj,key,key_len);
+        if(!t){
+            if(value->type!=JSON_OBJECT){
+                json_object_set_n(&target->_obj,key,key_len,json_clone(value));
+                continue;
+            }
+            //new objects still go through merge_patch, to drop the nulls in them
+            json_object_set_n(&target->_obj,key,key_len,make_literal(JSON_NULL));
+            t=json_object_get_n(&target->_obj,key,key_len);
+        }
+        merge_patch(t,value);
+    }
+}
+
+void json_merge_patch(JSON_Element * target,JSON_Element * patch){
+    merge_patch(target,patch);
+    json_free_element(patch);
+}
+
+//json patch
+
+typedef struct patch_location {
+    JSON_Element * parent;//NULL when the location is the root
+    char * token;//unescaped last token of the pointer, null-terminated
+    size_t len;
+} patch_location;
+
+//locations that are modified are resolved with mut, which unshares the path to them (see json_clone), read-only ones aren't
+
+static bool resolve_location(JSON_Element * target,JSON_String * path,patch_location * loc,bool mut){
+    loc->parent=NULL;
+    loc->token=NULL;
+    loc->len=0;
+    const char * s=json_string_data(path);
+    size_t len=json_string_length(path);
+    if(len==0)return true;
+    size_t last=len;
+    while(last>0&&s[last-1]!='/')last--;
+    if(last==0)return false;
+    JSON_Element tmp;
+    loc->parent=mut?json_pointer_get_mut_n(target,s,last-1):json_pointer_get_n(target,s,last-1,&tmp);
+    if(!loc->parent||loc->parent==&tmp)return false;//a packed item is a number, it can't be a parent
+    size_t n=len-last;
+    loc->token=malloc(n+1);
+    if(!loc->token){
+        OOM_EXIT();
+    }
+    loc->len=pointer_unescape_token(s+last,n,loc->token);
+    return loc->len!=SIZE_MAX;
+}
+
+static JSON_Element * location_get(JSON_Element * target,patch_location * loc,bool mut,JSON_Element * tmp){//packed items are copied into tmp when reading
+    size_t index;
+    if(!loc->parent)return target;
+    switch(loc->parent->type){
+    case JSON_OBJECT:
+        return mut?json_object_get_mut_n(&loc->parent->_obj,loc->token,loc->len):json_object_get_n(&loc->parent->_obj,loc->token,loc->len);
+    case JSON_ARRAY:
+        if(!pointer_index(loc->token,loc->len,&index))return NULL;
+        if(mut)return json_array_get_mut(&loc->parent->_arr,index);
+        return json_array_item(&loc->parent->_arr,index,tmp);
+    default:
+        return NULL;
+    }
+}
+
+static JSON_Element * location_take(patch_location * loc){
+    size_t index;
+    if(!loc->parent)return NULL;
+    switch(loc->parent->type){
+    case JSON_OBJECT:
+        return json_object_take_n(&loc->parent->_obj,loc->token,loc->len);
+    case JSON_ARRAY:
+        return pointer_index(loc->token,loc->len,&index)?json_array_take(&loc->parent->_arr,index):NULL;
+    default:
+        return NULL;
+    }
+}
+
+static bool location_add(JSON_Element * target,patch_location * loc,JSON_Element * value){
+    //value is only consumed on success
+    size_t index;
+    if(!loc->parent){
+        json_replace(target,value);
+        return true;
+    }
+    switch(loc->parent->type){
+    case JSON_OBJECT:
+        json_object_set_n(&loc->parent->_obj,loc->token,loc->len,value);
+        return true;
+    case JSON_ARRAY:
+        if(loc->len==1&&loc->token[0]=='-'){
+            json_array_push(&loc->parent->_arr,value);
+            return true;
+        }else if(pointer_index(loc->token,loc->len,&index)&&json_array_insert(&loc->parent->_arr,value,index)==0){
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+    return false;
+}
+
+static bool location_add_or_free(JSON_Element * target,patch_location * loc,JSON_Element * value){
+    if(location_add(target,loc,value))return true;
+    json_free_element(value);
+    return false;
+}
+
+static JSON_String * op_string(JSON_Object * op,const char * key){
+    JSON_Element * e=json_object_get(op,key);
+    return e&&e->type==JSON_STRING?&e->_str:NULL;
+}
+
+static bool is_proper_prefix(JSON_String * prefix,JSON_String * path){
+    size_t n=json_string_length(prefix);
+    return n<json_string_length(path)&&memcmp(json_string_data(prefix),json_string_data(path),n)==0&&json_string_data(path)[n]=='/';
+}
+
+static bool same_string(JSON_String * a,JSON_String * b){
+    return json_string_length(a)==json_string_length(b)&&memcmp(json_string_data(a),json_string_data(b),json_string_length(a))==0;
+}
+
+static bool apply_operation(JSON_Element * target,JSON_Object * op){
+    JSON_String * name=op_string(op,"op");
+    JSON_String * path=op_string(op,"path");
+    if(!name||!path)return false;
+    const char * op_name=json_string_data(name);
+    bool test=strcmp(op_name,"test")==0;
+    patch_location loc,from_loc={0};
+    bool ok=resolve_location(target,path,&loc,!test);
+    JSON_Element * value=json_object_get(op,"value");
+    JSON_String * from=op_string(op,"from");
+    JSON_Element * e;
+    JSON_Element tmp;
+    if(ok){
+        if(strcmp(op_name,"add")==0){
+            ok=value&&location_add_or_free(target,&loc,json_clone(value));
+        }else if(strcmp(op_name,"remove")==0){
+            e=location_take(&loc);
+            ok=e!=NULL;
+            json_free_element(e);
+        }else if(strcmp(op_name,"replace")==0){
+            e=location_get(target,&loc,true,&tmp);
+            ok=e&&value;
+            if(ok) json_replace(e,json_clone(value));
+        }else if(strcmp(op_name,"move")==0){
+            ok=from&&!is_proper_prefix(from,path);
+            if(ok&&!same_string(from,path)){
+                ok=resolve_location(target,from,&from_loc,true)&&(e=location_take(&from_loc))!=NULL;
+                if(ok){
+                    //taking the source can shift array entries, so the destination is resolved again
+                    free(loc.token);
+                    ok=resolve_location(target,path,&loc,true)&&location_add(target,&loc,e);
+                    if(!ok){
+                        //the destination is invalid, the source goes back so target only has the operations before this one
+                        //from_loc.parent is still valid, taking the source only changed the contents of its parent
+                        location_add(target,&from_loc,e);
+                    }
+                }
+            }
+        }else if(strcmp(op_name,"copy")==0){
+            ok=from&&resolve_location(target,from,&from_loc,false)&&(e=location_get(target,&from_loc,false,&tmp))!=NULL;
+            if(ok){
+                //the copy shares the containers of the source, which may hold the destination, so it's resolved again to unshare them
+                e=json_clone(e);
+                free(loc.token);
+                if(resolve_location(target,path,&loc,true)){
+                    ok=location_add_or_free(target,&loc,e);
+                }else{
+                    json_free_element(e);
+                    ok=false;
+                }
+            }
+        }else if(test){
+            e=location_get(target,&loc,false,&tmp);
+            ok=e&&value&&json_equal(e,value);
+        }else{
+            ok=false;
+        }
+    }
+    free(loc.token);
+    free(from_loc.token);
+    return ok;
+}
+
+int json_patch_apply(JSON_Element * target,JSON_Element * patch){
+    bool ok=patch->type==JSON_ARRAY;
+    for(size_t i=0;ok&&i<patch->_arr.size;i++){
+        JSON_Element tmp;
+        JSON_Element * op=json_array_item(&patch->_arr,i,&tmp);
+        ok=op->type==JSON_OBJECT&&apply_operation(target,&op->_obj);
+    }
+    json_free_element(patch);
+    return ok?0:1;
+}
+
+//diff
+
+static void add_op(JSON_Array * ops,const char * name,pointer_buffer * path,JSON_Element * value){
+    JSON_Object * op=json_make_object();
+    json_object_set(op,"op",(JSON_Element*)json_make_string(name));
+    json_object_set(op,"path",(JSON_Element*)json_make_string_n(path->s,path->len));
+    if(value) json_object_set(op,"value",value);
+    json_array_push(ops,(JSON_Element*)op);
+}
+
+static void diff(JSON_Array * ops,pointer_buffer * path,JSON_Element * from,JSON_Element * to){
+    size_t len=path->len;
+    if(from->type!=to->type){
+        add_op(ops,"replace",path,json_clone(to));
+    }else if(from->type==JSON_OBJECT){
+        JSON_Object_Iterator it={0};
+        const char * key;
+        size_t key_len;
+        JSON_Element * e;
+        while(json_object_next_n(&from->_obj,&it,&key,&key_len,&e)){
+            if(!json_object_get_n(&to->_obj,key,key_len)){
+                pointer_push_key_n(path,key,key_len);
+                add_op(ops,"remove",path,NULL);
+                path->len=len;
+            }
+        }
+        it=(JSON_Object_Iterator){0};
+        while(json_object_next_n(&to->_obj,&it,&key,&key_len,&e)){
+            JSON_Element * f=json_object_get_n(&from->_obj,key,key_len);
+            pointer_push_key_n(path,key,key_len);
+            if(f){
+                diff(ops,path,f,e);
+            }else{
+                add_op(ops,"add",path,json_clone(e));
+            }
+            path->len=len;
+        }
+    }else if(from->type==JSON_ARRAY){
+        //only the part between the common prefix and suffix is diffed, pairwise, then extra entries are removed or added
+        JSON_Array * a=&from->_arr;
+        JSON_Array * b=&to->_arr;
+        JSON_Element ta,tb;//packed items are read through these
+        size_t start=0;
+        while(start<a->size&&start<b->size&&json_equal(json_array_item(a,start,&ta),json_array_item(b,start,&tb)))start++;
+        size_t end_a=a->size,end_b=b->size;
+        while(end_a>start&&end_b>start&&json_equal(json_array_item(a,end_a-1,&ta),json_array_item(b,end_b-1,&tb))){
+            end_a--;
+            end_b--;
+        }
+        size_t na=end_a-start,nb=end_b-start;
+        size_t common=na<nb?na:nb;
+        for(size_t i=0;i<common;i++){
+            pointer_push_index(path,start+i);
+            diff(ops,path,json_array_item(a,start+i,&ta),json_array_item(b,start+i,&tb));
+            path->len=len;
+        }
+        for(size_t i=common;i<na;i++){
+            pointer_push_index(path,start+common);
+            add_op(ops,"remove",path,NULL);
+            path->len=len;
+        }
+        for(size_t i=common;i<nb;i++){
+            pointer_push_index(path,start+i);
+            add_op(ops,"add",path,json_clone(json_array_item(b,start+i,&tb)));
+            path->len=len;
+        }
+    }else if(!json_equal(from,to)){
+        add_op(ops,"replace",path,json_clone(to));
+    }
+    if(path->s) path->s[len]=0;
+}
+
+JSON_Element * json_diff(JSON_Element * from,JSON_Element * to){
+    JSON_Array * ops=json_make_array();
+    pointer_buffer path={0};
+    pointer_reserve(&path,0);
+    path.s[0]=0;
+    diff(ops,&path,from,to);
+    free(path.s);
+    return (JSON_Element*)ops;
+}
@@ -0,0 +1,306 @@
+#include "json_path.h"
+#include "json_internal.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct JSON_Path_Segment {
+    const char * key;//unescaped, null-terminated, can contain '\0' before len
+    size_t len;
+    uint32_t hash;
+    bool is_index;
+    size_t index;
+} JSON_Path_Segment;
+
+struct JSON_Path {
+    size_t count;
+    JSON_Path_Segment segments[];//key bytes are stored right after the segments, in the same allocation
+};
+
+struct JSON_Path_Batch {
+    size_t count;
+    size_t max_depth;
+    JSON_Path ** paths;
+    size_t * order;//paths sorted so that paths sharing a prefix are adjacent
+    size_t * shared;//number of leading segments order[i] shares with order[i-1]
+};
+
+//splits pointer into segments, unescaping them into out and setting their key and len in segments (if not NULL), returns the number of segments or -1 if invalid
+//lengths are kept, unescaped keys can contain '\0'
+static ptrdiff_t pointer_unescape(const char * pointer,size_t n,char * out,size_t * out_len,JSON_Path_Segment * segments){
+    if(n==0){
+        if(out_len) *out_len=0;
+        return 0;
+    }
+    if(pointer[0]!='/')return -1;
+    ptrdiff_t count=0;
+    size_t o=0,start=0;
+    for(size_t i=0;i<n;i++){
+        char c=pointer[i];
+        if(c=='/'){
+            if(count&&out) out[o]=0;
+            if(count&&segments) segments[count-1].len=o-start;
+            if(count) o++;
+            if(segments) segments[count].key=out+o;
+            start=o;
+            count++;
+        }else if(c=='~'){
+            if(i+1>=n||(pointer[i+1]!='0'&&pointer[i+1]!='1'))return -1;
+            if(out) out[o]=pointer[i+1]=='0'?'~':'/';
+            o++;
+            i++;
+        }else{
+            if(out) out[o]=c;
+            o++;
+        }
+    }
+    if(out) out[o]=0;
+    if(segments) segments[count-1].len=o-start;
+    o++;
+    if(out_len) *out_len=o;
+    return count;
+}
+
+bool pointer_index(const char * key,size_t len,size_t * index){
+    if(len==0||(len>1&&key[0]=='0'))return false;
+    size_t i=0;
+    for(size_t j=0;j<len;j++){
+        if(key[j]<'0'||key[j]>'9')return false;
+        if(i>(SIZE_MAX-9)/10)return false;
+        i=i*10+(key[j]-'0');
+    }
+    *index=i;
+    return true;
+}
+
+static JSON_Element * segment_get(JSON_Element * e,const char * key,size_t len,uint32_t hash,bool is_index,size_t index,bool mut,JSON_Element * tmp){
+    //packed items are numbers, so only the last segment can be copied into tmp
+    switch(e->type){
+    case JSON_OBJECT:
+        return mut?json_object_get_mut_n(&e->_obj,key,len):json_object_get_hashed(&e->_obj,key,len,hash);
+    case JSON_ARRAY:
+        if(!is_index)return NULL;
+        return mut?json_array_get_mut(&e->_arr,index):json_array_item(&e->_arr,index,tmp);
+    default:
+        return NULL;
+    }
+}
+
+JSON_Path * json_path_compile_n(const char * pointer,size_t n){
+    size_t keys_len;
+    ptrdiff_t count=pointer_unescape(pointer,n,NULL,&keys_len,NULL);
+    if(count<0)return NULL;
+    JSON_Path * path=malloc(sizeof(JSON_Path)+count*sizeof(JSON_Path_Segment)+keys_len);
+    if(!path){
+        OOM_EXIT();
+    }
+    path->count=count;
+    pointer_unescape(pointer,n,(char*)&path->segments[count],NULL,path->segments);
+    for(ptrdiff_t i=0;i<count;i++){
+        JSON_Path_Segment * seg=&path->segments[i];
+        seg->hash=json_key_hash_n(seg->key,seg->len);
+        seg->is_index=pointer_index(seg->key,seg->len,&seg->index);
+    }
+    return path;
+}
+
+JSON_Path * json_path_compile(const char * pointer){
+    return json_path_compile_n(pointer,strlen(pointer));
+}
+
+void json_path_free(JSON_Path * path){
+    free(path);
+}
+
+JSON_Element * json_path_eval(const JSON_Path * path,JSON_Element * root,JSON_Element * tmp){
+    JSON_Element * e=root;
+    for(size_t i=0;e&&i<path->count;i++){
+        const JSON_Path_Segment * seg=&path->segments[i];
+        e=segment_get(e,seg->key,seg->len,seg->hash,seg->is_index,seg->index,false,tmp);
+    }
+    return e;
+}
+
+size_t pointer_unescape_token(const char * token,size_t n,char * out){
+    size_t len=0;
+    for(size_t i=0;i<n;i++){
+        if(token[i]=='~'){
+            if(i+1>=n||(token[i+1]!='0'&&token[i+1]!='1'))return SIZE_MAX;
+            out[len++]=token[++i]=='0'?'~':'/';
+        }else{
+            out[len++]=token[i];
+        }
+    }
+    out[len]=0;
+    return len;
+}
+
+static JSON_Element * pointer_get(JSON_Element * root,const char * pointer,size_t n,bool mut,JSON_Element * tmp){
+    if(n==0)return root;
+    if(pointer[0]!='/')return NULL;
+    char buf[256];
+    JSON_Element * e=root;
+    size_t i=1;
+    while(e){
+        size_t end=i;
+        while(end<n&&pointer[end]!='/')end++;
+        //unescaped segments can only be shorter than escaped ones
+        char * key=(end-i)<sizeof(buf)?buf:malloc(end-i+1);
+        if(!key){
+            OOM_EXIT();
+        }
+        size_t len=pointer_unescape_token(pointer+i,end-i,key);
+        size_t index=0;
+        bool is_index=len!=SIZE_MAX&&pointer_index(key,len,&index);
+        e=len!=SIZE_MAX?segment_get(e,key,len,json_key_hash_n(key,len),is_index,index,mut,tmp):NULL;
+        if(key!=buf) free(key);
+        if(end>=n)break;
+        i=end+1;
+    }
+    return e;
+}
+
+JSON_Element * json_pointer_get_n(JSON_Element * root,const char * pointer,size_t n,JSON_Element * tmp){
+    return pointer_get(root,pointer,n,false,tmp);
+}
+
+JSON_Element * json_pointer_get(JSON_Element * root,const char * pointer,JSON_Element * tmp){
+    return json_pointer_get_n(root,pointer,strlen(pointer),tmp);
+}
+
+JSON_Element * json_pointer_get_mut_n(JSON_Element * root,const char * pointer,size_t n){
+    return pointer_get(root,pointer,n,true,NULL);
+}
+
+JSON_Element * json_pointer_get_mut(JSON_Element * root,const char * pointer){
+    return json_pointer_get_mut_n(root,pointer,strlen(pointer));
+}
+
+static int compare_paths(const JSON_Path * a,const JSON_Path * b){
+    size_t n=a->count<b->count?a->count:b->count;
+    for(size_t i=0;i<n;i++){
+        const JSON_Path_Segment * sa=&a->segments[i];
+        const JSON_Path_Segment * sb=&b->segments[i];
+        if(sa->len!=sb->len)return sa->len<sb->len?-1:1;
+        int c=memcmp(sa->key,sb->key,sa->len);
+        if(c)return c;
+    }
+    return (a->count>b->count)-(a->count<b->count);
+}
+
+static size_t shared_prefix(const JSON_Path * a,const JSON_Path * b){
+    size_t n=a->count<b->count?a->count:b->count;
+    size_t i=0;
+    for(;i<n;i++){
+        const JSON_Path_Segment * sa=&a->segments[i];
+        const JSON_Path_Segment * sb=&b->segments[i];
+        if(sa->len!=sb->len||memcmp(sa->key,sb->key,sa->len)!=0)break;
+    }
+    return i;
+}
+
+JSON_Path_Batch * json_path_batch_compile(const char * const * pointers,size_t count){
+    JSON_Path_Batch * batch=calloc(1,sizeof(JSON_Path_Batch));
+    if(!batch){
+        OOM_EXIT();
+    }
+    batch->count=count;
+    batch->paths=calloc(count,sizeof(JSON_Path*));
+    batch->order=calloc(count,sizeof(size_t));
+    batch->shared=calloc(count,sizeof(size_t));
+    if(count&&(!batch->paths||!batch->order||!batch->shared)){
+        OOM_EXIT();
+    }
+    for(size_t i=0;i<count;i++){
+        batch->paths[i]=json_path_compile(pointers[i]);
+        if(!batch->paths[i]){
+            json_path_batch_free(batch);
+            return NULL;
+        }
+        if(batch->paths[i]->count>batch->max_depth) batch->max_depth=batch->paths[i]->count;
+        //insertion sort, batches are compiled once and are usually small
+        size_t j=i;
+        while(j>0&&compare_paths(batch->paths[batch->order[j-1]],batch->paths[i])>0){
+            batch->order[j]=batch->order[j-1];
+            j--;
+        }
+        batch->order[j]=i;
+    }
+    for(size_t i=1;i<count;i++){
+        batch->shared[i]=shared_prefix(batch->paths[batch->order[i-1]],batch->paths[batch->order[i]]);
+    }
+    return batch;
+}
+
+void json_path_batch_free(JSON_Path_Batch * batch){
+    if(!batch)return;
+    for(size_t i=0;i<batch->count;i++){
+        json_path_free(batch->paths[i]);
+    }
+    free(batch->paths);
+    free(batch->order);
+    free(batch->shared);
+    free(batch);
+}
+
+void json_path_batch_eval(const JSON_Path_Batch * batch,JSON_Element * root,JSON_Element ** results,JSON_Element * tmp){
+    JSON_Element * stack_buf[32];
+    JSON_Element ** stack=batch->max_depth<32?stack_buf:malloc((batch->max_depth+1)*sizeof(JSON_Element*));
+    if(!stack){
+        OOM_EXIT();
+    }
+    stack[0]=root;
+    size_t resolved=0;//number of segments of the previous path whose elements are in the stack
+    for(size_t k=0;k<batch->count;k++){
+        const JSON_Path * path=batch->paths[batch->order[k]];
+        size_t depth=batch->shared[k];
+        if(depth>resolved){
+            //the shared prefix already failed to resolve for the previous path
+            results[batch->order[k]]=NULL;
+            continue;
+        }
+        JSON_Element * e=stack[depth];
+        while(depth<path->count){
+            const JSON_Path_Segment * seg=&path->segments[depth];
+            e=segment_get(e,seg->key,seg->len,seg->hash,seg->is_index,seg->index,false,&tmp[batch->order[k]]);
+            if(!e)break;
+            stack[++depth]=e;
+        }
+        resolved=depth;
+        results[batch->order[k]]=e;
+    }
+    if(stack!=stack_buf) free(stack);
+}
+
+void pointer_reserve(pointer_buffer * p,size_t n){
+    if(p->len+n+1<=p->alloc)return;
+    size_t new_alloc=p->alloc?p->alloc:64;
+    while(new_alloc<p->len+n+1)new_alloc*=2;//growth factor 2
+    p->s=realloc(p->s,new_alloc);
+    if(!p->s){
+        OOM_EXIT();
+    }
+    p->alloc=new_alloc;
+}
+
+void pointer_push_key_n(pointer_buffer * p,const char * key,size_t n){
+    pointer_reserve(p,1+n*2);
+    p->s[p->len++]='/';
+    for(size_t i=0;i<n;i++){
+        if(key[i]=='~'||key[i]=='/'){
+            p->s[p->len++]='~';
+            p->s[p->len++]=key[i]=='~'?'0':'1';
+        }else{
+            p->s[p->len++]=key[i];
+        }
+    }
+    p->s[p->len]=0;
+}
+
+void pointer_push_index(pointer_buffer * p,size_t index){
+    pointer_reserve(p,32);
+    p->len+=snprintf(p->s+p->len,32,"/%lu",(unsigned long)index);
+}
@@ -0,0 +1,668 @@
+#include "json_schema.h"
+#include "json_internal.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <math.h>
+
+#define SCHEMA_ANY SIZE_MAX
+
+#define TYPE_BIT(t) (1u<<(t))
+#define TYPES_ALL (TYPE_BIT(JSON_NULL)|TYPE_BIT(JSON_ARRAY)|TYPE_BIT(JSON_OBJECT)|TYPE_BIT(JSON_INTEGER)|TYPE_BIT(JSON_DOUBLE)|TYPE_BIT(JSON_STRING)|TYPE_BIT(JSON_TRUE)|TYPE_BIT(JSON_FALSE))
+#define TYPE_INTEGRAL_DOUBLE (1u<<16)//"integer" also accepts doubles without a fractional part
+
+#define NODE_MINIMUM 0x1
+#define NODE_MAXIMUM 0x2
+#define NODE_MAX_LENGTH 0x4
+#define NODE_NO_ADDITIONAL 0x8
+
+typedef struct schema_property {
+    char * key;
+    size_t len;
+    uint32_t hash;
+    bool required;
+    size_t node;
+} schema_property;
+
+typedef struct schema_node {
+    uint32_t types;
+    uint32_t flags;
+    double minimum;
+    double maximum;
+    size_t max_length;
+    size_t items;
+    size_t additional;
+    size_t props_start;
+    size_t props_count;
+    size_t required_count;
+    size_t enum_start;
+    size_t enum_count;
+} schema_node;
+
+struct JSON_Schema {
+    schema_node * nodes;
+    size_t nodes_count;
+    size_t nodes_alloc;
+    schema_property * props;
+    size_t props_count;
+    size_t props_alloc;
+    JSON_Element ** enums;
+    size_t enums_count;
+    size_t enums_alloc;
+};
+
+static void * grow(void * arr,size_t * alloc,size_t count,size_t item_size){
+    if(count<*alloc)return arr;
+    *alloc=*alloc?*alloc*2:8;//growth factor 2
+    arr=realloc(arr,*alloc*item_size);
+    if(!arr){
+        OOM_EXIT();
+    }
+    return arr;
+}
+
+//compilation
+
+static const char * type_names[]={"null","array","object","integer","number","string","boolean"};
+
+static uint32_t type_bits(const char * name){
+    if(strcmp(name,"null")==0)return TYPE_BIT(JSON_NULL);
+    if(strcmp(name,"array")==0)return TYPE_BIT(JSON_ARRAY);
+    if(strcmp(name,"object")==0)return TYPE_BIT(JSON_OBJECT);
+    if(strcmp(name,"integer")==0)return TYPE_BIT(JSON_INTEGER)|TYPE_INTEGRAL_DOUBLE;
+    if(strcmp(name,"number")==0)return TYPE_BIT(JSON_INTEGER)|TYPE_BIT(JSON_DOUBLE);
+    if(strcmp(name,"string")==0)return TYPE_BIT(JSON_STRING);
+    if(strcmp(name,"boolean")==0)return TYPE_BIT(JSON_TRUE)|TYPE_BIT(JSON_FALSE);
+    return 0;
+}
+
+static bool as_number(JSON_Element * e,double * d){
+    if(e->type==JSON_INTEGER){
+        *d=e->_int.i;
+    }else if(e->type==JSON_DOUBLE){
+        *d=e->_double.d;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+static JSON_Element * compile_node(JSON_Schema * s,JSON_Element * e,size_t * out);
+
+static JSON_Element * compile_properties(JSON_Schema * s,size_t node,JSON_Element * props,JSON_Element * required){
+    size_t start=s->props_count;
+    if(props){
+        if(props->type!=JSON_OBJECT)return parse_error("Schema 'properties' must be an object");
+        JSON_Object_Iterator it={0};
+        const char * key;
+        size_t key_len;
+        JSON_Element * child;
+        while(json_object_next_n(&props->_obj,&it,&key,&key_len,&child)){
+            s->props=grow(s->props,&s->props_alloc,s->props_count,sizeof(schema_property));
+            schema_property * p=&s->props[s->props_count++];
+            p->len=key_len;
+            p->key=malloc(p->len+1);
+            if(!p->key){
+                OOM_EXIT();
+            }
+            memcpy(p->key,key,p->len+1);
+            p->hash=json_key_hash_n(key,key_len);
+            p->required=false;
+            p->node=SCHEMA_ANY;//compiled once the whole range is in place
+        }
+    }
+    size_t required_count=0;
+    if(required){
+        if(required->type!=JSON_ARRAY)return parse_error("Schema 'required' must be an array");
+        for(size_t i=0;i<required->_arr.size;i++){
+            JSON_Element tmp;
+            JSON_Element * r=json_array_item(&required->_arr,i,&tmp);
+            if(r->type!=JSON_STRING)return parse_error("Schema 'required' entries must be strings");
+            const char * name=json_string_data(&r->_str);
+            size_t name_len=json_string_length(&r->_str);
+            size_t j=start;
+            for(;j<s->props_count;j++){
+                if(s->props[j].len==name_len&&memcmp(s->props[j].key,name,name_len)==0)break;
+            }
+            if(j==s->props_count){
+                //required but not described, accepts anything
+                s->props=grow(s->props,&s->props_alloc,s->props_count,sizeof(schema_property));
+                schema_property * p=&s->props[s->props_count++];
+                p->len=name_len;
+                p->key=malloc(p->len+1);
+                if(!p->key){
+                    OOM_EXIT();
+                }
+                memcpy(p->key,name,p->len+1);
+                p->hash=json_key_hash_n(name,name_len);
+                p->node=SCHEMA_ANY;
+                p->required=false;
+            }
+            if(!s->props[j].required){
+                s->props[j].required=true;
+                required_count++;
+            }
+        }
+    }
+    s->nodes[node].props_start=start;
+    s->nodes[node].props_count=s->props_count-start;
+    s->nodes[node].required_count=required_count;
+    if(props){
+        //children append their own properties after this node's range
+        JSON_Object_Iterator it={0};
+        JSON_Element * child;
+        for(size_t i=start;json_object_next(&props->_obj,&it,NULL,&child);i++){
+            size_t child_node;
+            JSON_Element * err=compile_node(s,child,&child_node);
+            if(err)return err;
+            s->props[i].node=child_node;
+        }
+    }
+    return NULL;
+}
+
+static JSON_Element * compile_node(JSON_Schema * s,JSON_Element * e,size_t * out){
+    if(e->type==JSON_TRUE){
+        *out=SCHEMA_ANY;
+        return NULL;
+    }
+    s->nodes=grow(s->nodes,&s->nodes_alloc,s->nodes_count,sizeof(schema_node));
+    size_t node=s->nodes_count++;
+    memset(&s->nodes[node],0,sizeof(schema_node));
+    s->nodes[node].items=SCHEMA_ANY;
+    s->nodes[node].additional=SCHEMA_ANY;
+    *out=node;
+    if(e->type==JSON_FALSE){
+        //matches nothing
+        return NULL;
+    }
+    if(e->type!=JSON_OBJECT)return parse_error("Schema must be an object or a boolean");
+    JSON_Object * obj=&e->_obj;
+    JSON_Element * v;
+    uint32_t types=TYPES_ALL;
+    if((v=json_object_get(obj,"type"))){
+        types=0;
+        if(v->type==JSON_STRING){
+            types=type_bits(json_string_data(&v->_str));
+        }else if(v->type==JSON_ARRAY){
+            for(size_t i=0;i<v->_arr.size&&!v->_arr.packed;i++){
+                if(v->_arr.arr[i].type==JSON_STRING) types|=type_bits(json_string_data(&v->_arr.arr[i]._str));
+            }
+        }
+        if(!types)return parse_error("Invalid schema 'type'");
+    }
+    if((types&TYPE_INTEGRAL_DOUBLE)&&(types&TYPE_BIT(JSON_DOUBLE))) types&=~TYPE_INTEGRAL_DOUBLE;
+    s->nodes[node].types=types;
+    if((v=json_object_get(obj,"minimum"))){
+        if(!as_number(v,&s->nodes[node].minimum))return parse_error("Schema 'minimum' must be a number");
+        s->nodes[node].flags|=NODE_MINIMUM;
+    }
+    if((v=json_object_get(obj,"maximum"))){
+        if(!as_number(v,&s->nodes[node].maximum))return parse_error("Schema 'maximum' must be a number");
+        s->nodes[node].flags|=NODE_MAXIMUM;
+    }
+    if((v=json_object_get(obj,"maxLength"))){
+        if(v->type!=JSON_INTEGER||v->_int.i<0)return parse_error("Schema 'maxLength' must be a non-negative integer");
+        s->nodes[node].max_length=v->_int.i;
+        s->nodes[node].flags|=NODE_MAX_LENGTH;
+    }
+    if((v=json_object_get(obj,"enum"))){
+        if(v->type!=JSON_ARRAY)return parse_error("Schema 'enum' must be an array");
+        s->nodes[node].enum_start=s->enums_count;
+        s->nodes[node].enum_count=v->_arr.size;
+        for(size_t i=0;i<v->_arr.size;i++){
+            s->enums=grow(s->enums,&s->enums_alloc,s->enums_count,sizeof(JSON_Element*));
+            JSON_Element tmp;
+            s->enums[s->enums_count++]=json_clone(json_array_item(&v->_arr,i,&tmp));
+        }
+    }
+    JSON_Element * err;
+    size_t child;
+    if((v=json_object_get(obj,"items"))){
+        if((err=compile_node(s,v,&child)))return err;
+        s->nodes[node].items=child;
+    }
+    if((v=json_object_get(obj,"additionalProperties"))){
+        if(v->type==JSON_FALSE){
+            s->nodes[node].flags|=NODE_NO_ADDITIONAL;
+        }else{
+            if((err=compile_node(s,v,&child)))return err;
+            s->nodes[node].additional=child;
+        }
+    }
+    return compile_properties(s,node,json_object_get(obj,"properties"),json_object_get(obj,"required"));
+}
+
+JSON_Schema * json_schema_compile(JSON_Element * schema,JSON_Element ** error){
+    JSON_Schema * s=calloc(1,sizeof(JSON_Schema));
+    if(!s){
+        OOM_EXIT();
+    }
+    size_t root;
+    JSON_Element * err=compile_node(s,schema,&root);
+    if(!err&&root==SCHEMA_ANY){
+        //keep the root at node 0
+        s->nodes=grow(s->nodes,&s->nodes_alloc,s->nodes_count,sizeof(schema_node));
+        memset(&s->nodes[0],0,sizeof(schema_node));
+        s->nodes[0].types=TYPES_ALL;
+        s->nodes[0].items=SCHEMA_ANY;
+        s->nodes[0].additional=SCHEMA_ANY;
+        s->nodes_count=1;
+    }
+    if(err){
+        json_schema_free(s);
+        if(error){
+            *error=err;
+        }else{
+            json_free_element(err);
+        }
+        return NULL;
+    }
+    return s;
+}
+
+void json_schema_free(JSON_Schema * schema){
+    if(!schema)return;
+    for(size_t i=0;i<schema->props_count;i++){
+        free(schema->props[i].key);
+    }
+    for(size_t i=0;i<schema->enums_count;i++){
+        json_free_element(schema->enums[i]);
+    }
+    free(schema->nodes);
+    free(schema->props);
+    free(schema->enums);
+    free(schema);
+}
+
+//checks shared by the streaming and the tree validators
+
+typedef struct validator {
+    const JSON_Schema * schema;
+    bool build;
+    pointer_buffer path;
+} validator;
+
+static JSON_Element * violation(validator * v,const char * fmt,...){
+    char msg[256];
+    va_list args;
+    va_start(args,fmt);
+    vsnprintf(msg,sizeof(msg),fmt,args);
+    va_end(args);
+    return parse_error("Schema violation at '%s': %s",v->path.len?v->path.s:"",msg);
+}
+
+static const char * type_name(JSON_Element_Type type){
+    switch(type){
+    case JSON_TRUE:
+    case JSON_FALSE:
+        return "boolean";
+    case JSON_DOUBLE:
+        return "number";
+    default:
+        return type<JSON_PARSE_ERROR?type_names[type]:"invalid";
+    }
+}
+
+static JSON_Element * check_type(validator * v,const schema_node * n,JSON_Element_Type type,double d){
+    if(n->types&TYPE_BIT(type))return NULL;
+    if(type==JSON_DOUBLE&&(n->types&TYPE_INTEGRAL_DOUBLE)&&floor(d)==d)return NULL;
+    char expected[128]="";
+    size_t len=0;
+    for(size_t i=0;i<sizeof(type_names)/sizeof(type_names[0]);i++){
+        uint32_t bits=type_bits(type_names[i]);
+        if((bits&n->types)==bits){
+            len+=snprintf(expected+len,sizeof(expected)-len,"%s%s",len?"|":"",type_names[i]);
+        }
+    }
+    return violation(v,"expected %s, got %s",len?expected:"nothing",type_name(type));
+}
+
+static JSON_Element * check_number(validator * v,const schema_node * n,double d){
+    if((n->flags&NODE_MINIMUM)&&d<n->minimum)return violation(v,"%g is less than minimum %g",d,n->minimum);
+    if((n->flags&NODE_MAXIMUM)&&d>n->maximum)return violation(v,"%g is greater than maximum %g",d,n->maximum);
+    return NULL;
+}
+
+static JSON_Element * check_string(validator * v,const schema_node * n,const char * s,size_t len){
+    if(!(n->flags&NODE_MAX_LENGTH)||len<=n->max_length)return NULL;
+    size_t chars=0;//maxLength counts code points, not bytes
+    for(size_t i=0;i<len;i++){
+        if((s[i]&0xC0)!=0x80)chars++;
+    }
+    if(chars>n->max_length)return violation(v,"string is longer than maxLength %lu",(unsigned long)n->max_length);
+    return NULL;
+}
+
+static JSON_Element * check_enum(validator * v,const schema_node * n,JSON_Element * e){
+    for(size_t i=0;i<n->enum_count;i++){
+        if(json_equal(v->schema->enums[n->enum_start+i],e))return NULL;
+    }
+    return violation(v,"value is not one of the enum values");
+}
+
+static const schema_property * find_property(const JSON_Schema * s,const schema_node * n,const char * key,size_t len,uint32_t hash){
+    for(size_t i=0;i<n->props_count;i++){
+        const schema_property * p=&s->props[n->props_start+i];
+        if(p->hash==hash&&p->len==len&&memcmp(p->key,key,len)==0)return p;
+    }
+    return NULL;
+}
+
+static JSON_Element * check_required(validator * v,const schema_node * n,const uint64_t * seen){
+    for(size_t i=0;i<n->props_count;i++){
+        const schema_property * p=&v->schema->props[n->props_start+i];
+        if(p->required&&!(seen[i/64]&(1ull<<(i%64)))){
+            return violation(v,"missing required property '%s'",p->key);
+        }
+    }
+    return NULL;
+}
+
+//tree validator
+
+static JSON_Element * validate_element(validator * v,size_t node,JSON_Element * e){
+    if(node==SCHEMA_ANY)return NULL;
+    const schema_node * n=&v->schema->nodes[node];
+    double d=0;
+    as_number(e,&d);
+    JSON_Element * err=check_type(v,n,e->type,d);
+    if(!err&&n->enum_count) err=check_enum(v,n,e);
+    if(err)return err;
+    size_t len=v->path.len;
+    switch(e->type){
+    case JSON_INTEGER:
+    case JSON_DOUBLE:
+        return check_number(v,n,d);
+    case JSON_STRING:
+        return check_string(v,n,json_string_data(&e->_str),json_string_length(&e->_str));
+    case JSON_ARRAY:
+        for(size_t i=0;i<e->_arr.size&&n->items!=SCHEMA_ANY;i++){
+            JSON_Element tmp;
+            pointer_push_index(&v->path,i);
+            err=validate_element(v,n->items,json_array_item(&e->_arr,i,&tmp));
+            v->path.len=len;
+            v->path.s[len]=0;
+            if(err)return err;
+        }
+        return NULL;
+    case JSON_OBJECT:{
+            uint64_t seen_buf[4]={0};
+            uint64_t * seen=n->props_count<=256?seen_buf:calloc((n->props_count+63)/64,sizeof(uint64_t));
+            if(!seen){
+                OOM_EXIT();
+            }
+            JSON_Object_Iterator it={0};
+            const char * key;
+            size_t key_len;
+            JSON_Element * child;
+            while(!err&&json_object_next_n(&e->_obj,&it,&key,&key_len,&child)){
+                const schema_property * p=find_property(v->schema,n,key,key_len,json_key_hash_n(key,key_len));
+                size_t child_node=n->additional;
+                if(p){
+                    child_node=p->node;
+                    size_t i=p-&v->schema->props[n->props_start];
+                    seen[i/64]|=1ull<<(i%64);
+                }else if(n->flags&NODE_NO_ADDITIONAL){
+                    err=violation(v,"unexpected property '%s'",key);
+                    break;
+                }
+                pointer_push_key_n(&v->path,key,key_len);
+                err=validate_element(v,child_node,child);
+                v->path.len=len;
+                v->path.s[len]=0;
+            }
+            if(!err&&n->required_count) err=check_required(v,n,seen);
+            if(seen!=seen_buf) free(seen);
+            return err;
+        }
+    default:
+        return NULL;
+    }
+}
+
+//streaming validator, checks values as they are tokenized, and only builds the tree if asked to
+
+static JSON_Element * vparse(validator * v,JSON_Lexer * p,size_t node,JSON_Element ** out);
+
+static JSON_Element * lex_unexpected(JSON_Lexer * p,const char * expected){
+    json_lex_unexpected(p,expected);
+    return json_error_element(&p->error);
+}
+
+static JSON_Element * vparse_object(validator * v,JSON_Lexer * p,const schema_node * n,JSON_Element ** out){
+    ++p->i;
+    JSON_Object * obj=v->build?json_make_object():NULL;
+    uint64_t seen_buf[4]={0};
+    uint64_t * seen=(!n||n->props_count<=256)?seen_buf:calloc((n->props_count+63)/64,sizeof(uint64_t));
+    if(!seen){
+        OOM_EXIT();
+    }
+    char key_buf[256];
+    char * key=key_buf;
+    size_t key_alloc=sizeof(key_buf);
+    size_t path_len=v->path.len;
+    JSON_Element * err=NULL;
+    json_lex_whitespace(p);
+    bool done=p->i<p->n&&p->s[p->i]=='}';
+    if(done) ++p->i;
+    while(!done){
+        size_t key_len;
+        if(!json_lex_string_length(p,&key_len)){
+            err=json_error_element(&p->error);
+            break;
+        }
+        if(key_len+1>key_alloc){
+            key_alloc=key_len+1;
+            key=key==key_buf?malloc(key_alloc):realloc(key,key_alloc);
+            if(!key){
+                OOM_EXIT();
+            }
+        }
+        json_lex_string_copy(p,key);
+        key[key_len]=0;
+        json_lex_whitespace(p);
+        if(p->i>=p->n||p->s[p->i]!=':'){
+            err=lex_unexpected(p,"':'");
+            break;
+        }
+        ++p->i;
+        size_t child_node=SCHEMA_ANY;
+        if(n){
+            const schema_property * prop=find_property(v->schema,n,key,key_len,json_key_hash(key));
+            child_node=n->additional;
+            if(prop){
+                child_node=prop->node;
+                size_t i=prop-&v->schema->props[n->props_start];
+                seen[i/64]|=1ull<<(i%64);
+            }else if(n->flags&NODE_NO_ADDITIONAL){
+                err=violation(v,"unexpected property '%s'",key);
+                break;
+            }
+        }
+        pointer_push_key_n(&v->path,key,key_len);
+        JSON_Element * child=NULL;
+        err=vparse(v,p,child_node,&child);
+        v->path.len=path_len;
+        if(v->path.s) v->path.s[path_len]=0;
+        if(err)break;
+        if(obj) json_object_set_n(obj,key,key_len,child);
+        json_lex_whitespace(p);
+        if(p->i>=p->n){
+            err=lex_unexpected(p,"'}'");
+            break;
+        }else if(p->s[p->i]==','){
+            ++p->i;
+            json_lex_whitespace(p);
+            if(p->i<p->n&&p->s[p->i]=='}'){
+                ++p->i;
+                done=true;
+            }
+        }else if(p->s[p->i]=='}'){
+            ++p->i;
+            done=true;
+        }else{
+            err=lex_unexpected(p,"'}'");
+            break;
+        }
+    }
+    if(!err&&n&&n->required_count) err=check_required(v,n,seen);
+    if(key!=key_buf) free(key);
+    if(seen!=seen_buf) free(seen);
+    if(err){
+        json_free_object(obj);
+        return err;
+    }
+    *out=(JSON_Element*)obj;
+    return NULL;
+}
+
+static JSON_Element * vparse_array(validator * v,JSON_Lexer * p,const schema_node * n,JSON_Element ** out){
+    ++p->i;
+    JSON_Array * arr=v->build?json_make_array():NULL;
+    size_t items=n?n->items:SCHEMA_ANY;
+    size_t path_len=v->path.len;
+    JSON_Element * err=NULL;
+    json_lex_whitespace(p);
+    bool done=p->i<p->n&&p->s[p->i]==']';
+    if(done) ++p->i;
+    for(size_t i=0;!done;i++){
+        pointer_push_index(&v->path,i);
+        JSON_Element * child=NULL;
+        err=vparse(v,p,items,&child);
+        v->path.len=path_len;
+        v->path.s[path_len]=0;
+        if(err)break;
+        if(arr) json_array_push(arr,child);
+        json_lex_whitespace(p);
+        if(p->i>=p->n){
+            err=lex_unexpected(p,"']'");
+            break;
+        }else if(p->s[p->i]==','){
+            ++p->i;
+            json_lex_whitespace(p);
+            if(p->i<p->n&&p->s[p->i]==']'){
+                ++p->i;
+                done=true;
+            }
+        }else if(p->s[p->i]==']'){
+            ++p->i;
+            done=true;
+        }else{
+            err=lex_unexpected(p,"']'");
+            break;
+        }
+    }
+    if(err){
+        json_free_array(arr);
+        return err;
+    }
+    *out=(JSON_Element*)arr;
+    return NULL;
+}
+
+static JSON_Element * vparse(validator * v,JSON_Lexer * p,size_t node,JSON_Element ** out){
+    const schema_node * n=node==SCHEMA_ANY?NULL:&v->schema->nodes[node];
+    if(!n&&!v->build)return json_lex_skip(p)?NULL:json_error_element(&p->error);
+    if(n&&n->enum_count){
+        //enum values are compared as trees
+        JSON_Element * e=json_parse_element(p);
+        if(!e)return json_error_element(&p->error);
+        JSON_Element * err=validate_element(v,node,e);
+        if(err||!v->build){
+            json_free_element(e);
+            return err;
+        }
+        *out=e;
+        return NULL;
+    }
+    json_lex_whitespace(p);
+    if(p->i>=p->n) return lex_unexpected(p,"JSON Element");
+    char c=p->s[p->i];
+    JSON_Element * err=NULL;
+    if(c=='{'||c=='['){
+        JSON_Element_Type type=c=='{'?JSON_OBJECT:JSON_ARRAY;
+        //type mismatches are reported before reading the contents
+        if(n&&(err=check_type(v,n,type,0)))return err;
+        return type==JSON_OBJECT?vparse_object(v,p,n,out):vparse_array(v,p,n,out);
+    }else if(c=='"'||c=='\''){
+        if(n&&(err=check_type(v,n,JSON_STRING,0)))return err;
+        size_t len;
+        if(!json_lex_string_length(p,&len))return json_error_element(&p->error);
+        if(!v->build&&!(n&&(n->flags&NODE_MAX_LENGTH))){
+            json_lex_string_copy(p,NULL);
+            return NULL;
+        }
+        JSON_Element * e=json_parse_element(p);
+        if(n&&(err=check_string(v,n,json_string_data(&e->_str),json_string_length(&e->_str)))){
+            json_free_element(e);
+            return err;
+        }
+        if(v->build){
+            *out=e;
+        }else{
+            json_free_element(e);
+        }
+        return NULL;
+    }else if((c>='0'&&c<='9')||c=='.'||c=='-'||c=='+'){
+        JSON_Number number;
+        bool is_double;
+        if(!json_lex_number(p,&number,&is_double))return json_error_element(&p->error);
+        double d=is_double?number.d:(double)number.i;
+        if(n&&((err=check_type(v,n,is_double?JSON_DOUBLE:JSON_INTEGER,d))||(err=check_number(v,n,d))))return err;
+        if(v->build) *out=is_double?(JSON_Element*)json_make_double(number.d):(JSON_Element*)json_make_integer(number.i);
+        return NULL;
+    }else{
+        JSON_Element_Type type=json_lex_literal(p);
+        if(type==JSON_PARSE_ERROR)return lex_unexpected(p,"JSON Element");
+        if(n&&(err=check_type(v,n,type,0)))return err;
+        if(v->build){
+            *out=calloc(1,sizeof(JSON_Element));
+            if(!*out){
+                OOM_EXIT();
+            }
+            (*out)->type=type;
+        }
+        return NULL;
+    }
+}
+
+static JSON_Element * run_validator(const JSON_Schema * schema,const char * s,size_t n,bool build){
+    validator v={.schema=schema,.build=build,.path={0}};
+    pointer_reserve(&v.path,0);
+    v.path.s[0]=0;
+    JSON_Lexer p={.i=0,.s=s,.n=n};
+    JSON_Element * out=NULL;
+    JSON_Element * err=vparse(&v,&p,0,&out);
+    free(v.path.s);
+    return err?err:out;
+}
+
+JSON_Element * json_parse_validated_n(const char * s,size_t n,const JSON_Schema * schema){
+    return run_validator(schema,s,n,true);
+}
+
+JSON_Element * json_parse_validated(const char * s,const JSON_Schema * schema){
+    return json_parse_validated_n(s,strlen(s),schema);
+}
+
+JSON_Element * json_validate_n(const char * s,size_t n,const JSON_Schema * schema){
+    return run_validator(schema,s,n,false);
+}
+
+JSON_Element * json_validate(const char * s,const JSON_Schema * schema){
+    return json_validate_n(s,strlen(s),schema);
+}
+
+JSON_Element * json_schema_validate(const JSON_Schema * schema,JSON_Element * elem){
+    validator v={.schema=schema,.build=false,.path={0}};
+    pointer_reserve(&v.path,0);
+    v.path.s[0]=0;
+    JSON_Element * err=validate_element(&v,0,elem);
+    free(v.path.s);
+    return err;
+}
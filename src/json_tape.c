@@ -0,0 +1,497 @@
+#include "json_tape.h"
+#include "json_internal.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TAPE_ARRAY_END 0x10
+#define TAPE_OBJECT_END 0x11
+
+#define TAPE_TAG(w) ((uint8_t)((w)>>56))
+#define TAPE_PAYLOAD(w) ((w)&0x00FFFFFFFFFFFFFFull)
+#define TAPE_WORD(tag,payload) (((uint64_t)(tag)<<56)|(payload))
+#define TAPE_MAX_COUNT 0xFFFFFFull
+
+typedef struct tape_container {
+    size_t start;
+    size_t count;
+} tape_container;
+
+typedef struct tape_builder {
+    JSON_Tape * t;
+    size_t alloc;
+    size_t strings_alloc;
+    tape_container * stack;
+    size_t depth;
+    size_t stack_alloc;
+} tape_builder;
+
+static void tape_push(tape_builder * b,uint64_t word){
+    if(b->t->size==b->alloc){
+        b->alloc=b->alloc?b->alloc*2:64;//growth factor 2
+        b->t->tape=realloc(b->t->tape,b->alloc*sizeof(uint64_t));
+        if(!b->t->tape){
+            OOM_EXIT();
+        }
+    }
+    b->t->tape[b->t->size++]=word;
+}
+
+static char * tape_push_string(tape_builder * b,size_t n){
+    size_t needed=b->t->strings_size+sizeof(uint32_t)+n+1;
+    if(needed>b->strings_alloc){
+        size_t new_alloc=b->strings_alloc?b->strings_alloc:256;
+        while(new_alloc<needed)new_alloc*=2;//growth factor 2
+        b->t->strings=realloc(b->t->strings,new_alloc);
+        if(!b->t->strings){
+            OOM_EXIT();
+        }
+        b->strings_alloc=new_alloc;
+    }
+    uint32_t len=n;
+    char * s=b->t->strings+b->t->strings_size;
+    tape_push(b,TAPE_WORD(JSON_STRING,b->t->strings_size));
+    memcpy(s,&len,sizeof(len));
+    s[sizeof(uint32_t)+n]=0;
+    b->t->strings_size=needed;
+    return s+sizeof(uint32_t);
+}
+
+static void tape_push_raw(tape_builder * b,JSON_Element_Type type,const void * value){
+    uint64_t raw;
+    memcpy(&raw,value,sizeof(raw));
+    tape_push(b,TAPE_WORD(type,0));
+    tape_push(b,raw);
+}
+
+static void tape_open(tape_builder * b,JSON_Element_Type type){
+    if(b->depth==b->stack_alloc){
+        b->stack_alloc=b->stack_alloc?b->stack_alloc*2:16;//growth factor 2
+        b->stack=realloc(b->stack,b->stack_alloc*sizeof(tape_container));
+        if(!b->stack){
+            OOM_EXIT();
+        }
+    }
+    b->stack[b->depth].start=b->t->size;
+    b->stack[b->depth].count=0;
+    b->depth++;
+    tape_push(b,TAPE_WORD(type,0));
+}
+
+static void tape_close(tape_builder * b){
+    tape_container * c=&b->stack[--b->depth];
+    uint64_t * start=&b->t->tape[c->start];
+    uint64_t count=c->count>TAPE_MAX_COUNT?TAPE_MAX_COUNT:c->count;
+    *start=TAPE_WORD(TAPE_TAG(*start),(count<<32)|b->t->size);
+    tape_push(b,TAPE_WORD(TAPE_TAG(*start)==JSON_ARRAY?TAPE_ARRAY_END:TAPE_OBJECT_END,c->start));
+}
+
+static JSON_Element * tape_unexpected(JSON_Lexer * p,const char * expected){
+    json_lex_unexpected(p,expected);
+    return json_error_element(&p->error);
+}
+
+static JSON_Element * tape_parse_string(tape_builder * b,JSON_Lexer * p){
+    size_t n;
+    if(!json_lex_string_length(p,&n)){
+        return json_error_element(&p->error);
+    }
+    if(n>UINT32_MAX){
+        return parse_error("String too long for tape");
+    }
+    json_lex_string_copy(p,tape_push_string(b,n));
+    return NULL;
+}
+
+typedef enum tape_state {
+    TAPE_VALUE,
+    TAPE_KEY,
+    TAPE_AFTER_VALUE,
+} tape_state;
+
+static JSON_Element * tape_parse(tape_builder * b,JSON_Lexer * p){
+    //iterative, so deeply nested documents don't exhaust the stack
+    tape_state state=TAPE_VALUE;
+    while(true){
+        JSON_Element * err=NULL;
+        char c;
+        switch(state){
+        case TAPE_VALUE:
+            json_lex_whitespace(p);
+            if(p->i>=p->n) return tape_unexpected(p,"JSON Element");
+            if(b->t->size>=(TAPE_PAYLOAD(~0ull)>>24)) return parse_error("Document too large for tape");
+            c=p->s[p->i];
+            if(b->depth) b->stack[b->depth-1].count++;
+            if(c=='{'||c=='['){
+                ++p->i;
+                tape_open(b,c=='{'?JSON_OBJECT:JSON_ARRAY);
+                json_lex_whitespace(p);
+                if(p->i<p->n&&p->s[p->i]==(c=='{'?'}':']')){
+                    ++p->i;
+                    tape_close(b);
+                    state=TAPE_AFTER_VALUE;
+                }else{
+                    state=c=='{'?TAPE_KEY:TAPE_VALUE;
+                }
+                break;
+            }else if(c=='"'||c=='\''){
+                err=tape_parse_string(b,p);
+            }else if((c>='0'&&c<='9')||c=='.'||c=='-'||c=='+'){
+                JSON_Number number;
+                bool is_double;
+                if(!json_lex_number(p,&number,&is_double)) return json_error_element(&p->error);
+                tape_push_raw(b,is_double?JSON_DOUBLE:JSON_INTEGER,&number);
+            }else{
+                JSON_Element_Type type=json_lex_literal(p);
+                if(type==JSON_PARSE_ERROR) return tape_unexpected(p,"JSON Element");
+                tape_push(b,TAPE_WORD(type,0));
+            }
+            if(err) return err;
+            state=TAPE_AFTER_VALUE;
+            break;
+        case TAPE_KEY:
+            err=tape_parse_string(b,p);
+            if(err) return err;
+            json_lex_whitespace(p);
+            if(p->i>=p->n||p->s[p->i]!=':'){
+                return tape_unexpected(p,"':'");
+            }
+            ++p->i;
+            state=TAPE_VALUE;
+            break;
+        case TAPE_AFTER_VALUE:{
+                if(!b->depth) return NULL;
+                bool is_object=TAPE_TAG(b->t->tape[b->stack[b->depth-1].start])==JSON_OBJECT;
+                char close=is_object?'}':']';
+                json_lex_whitespace(p);
+                if(p->i>=p->n){
+                    return tape_unexpected(p,is_object?"'}'":"']'");
+                }else if(p->s[p->i]==','){
+                    ++p->i;
+                    json_lex_whitespace(p);
+                    if(p->i<p->n&&p->s[p->i]==close){
+                        ++p->i;
+                        tape_close(b);
+                    }else{
+                        state=is_object?TAPE_KEY:TAPE_VALUE;
+                    }
+                }else if(p->s[p->i]==close){
+                    ++p->i;
+                    tape_close(b);
+                }else{
+                    return tape_unexpected(p,is_object?"'}'":"']'");
+                }
+                break;
+            }
+        }
+    }
+}
+
+static JSON_Tape * tape_builder_init(tape_builder * b){
+    memset(b,0,sizeof(*b));
+    b->t=calloc(1,sizeof(JSON_Tape));
+    if(!b->t){
+        OOM_EXIT();
+    }
+    return b->t;
+}
+
+JSON_Tape * json_parse_tape_n(const char * s,size_t n,JSON_Element ** error){
+    tape_builder b;
+    tape_builder_init(&b);
+    JSON_Lexer p = {.i=0,.s=s,.n=n};
+    JSON_Element * err=tape_parse(&b,&p);
+    free(b.stack);
+    if(err){
+        json_free_tape(b.t);
+        if(error){
+            *error=err;
+        }else{
+            json_free_element(err);
+        }
+        return NULL;
+    }
+    return b.t;
+}
+
+JSON_Tape * json_parse_tape(const char * s,JSON_Element ** error){
+    return json_parse_tape_n(s,strlen(s),error);
+}
+
+void json_free_tape(JSON_Tape * tape){
+    if(!tape)return;
+    free(tape->tape);
+    free(tape->strings);
+    free(tape);
+}
+
+JSON_Element_Type json_tape_type(const JSON_Tape * tape,size_t i){
+    if(i>=tape->size)return JSON_PARSE_ERROR;
+    uint8_t tag=TAPE_TAG(tape->tape[i]);
+    return tag<JSON_PARSE_ERROR?(JSON_Element_Type)tag:JSON_PARSE_ERROR;
+}
+
+int64_t json_tape_integer(const JSON_Tape * tape,size_t i){
+    int64_t v;
+    switch(json_tape_type(tape,i)){
+    case JSON_INTEGER:
+        memcpy(&v,&tape->tape[i+1],sizeof(v));
+        return v;
+    case JSON_DOUBLE:
+        return (int64_t)json_tape_double(tape,i);
+    default:
+        return 0;
+    }
+}
+
+double json_tape_double(const JSON_Tape * tape,size_t i){
+    double v;
+    switch(json_tape_type(tape,i)){
+    case JSON_DOUBLE:
+        memcpy(&v,&tape->tape[i+1],sizeof(v));
+        return v;
+    case JSON_INTEGER:
+        return (double)json_tape_integer(tape,i);
+    default:
+        return 0;
+    }
+}
+
+const char * json_tape_string(const JSON_Tape * tape,size_t i,size_t * len){
+    if(json_tape_type(tape,i)!=JSON_STRING)return NULL;
+    const char * s=tape->strings+TAPE_PAYLOAD(tape->tape[i]);
+    if(len){
+        uint32_t n;
+        memcpy(&n,s,sizeof(n));
+        *len=n;
+    }
+    return s+sizeof(uint32_t);
+}
+
+size_t json_tape_child(size_t i){
+    return i+1;
+}
+
+size_t json_tape_end(const JSON_Tape * tape,size_t i){
+    switch(json_tape_type(tape,i)){
+    case JSON_ARRAY:
+    case JSON_OBJECT:
+        return TAPE_PAYLOAD(tape->tape[i])&0xFFFFFFFFull;
+    default:
+        return i;
+    }
+}
+
+size_t json_tape_next(const JSON_Tape * tape,size_t i){
+    switch(json_tape_type(tape,i)){
+    case JSON_ARRAY:
+    case JSON_OBJECT:
+        return json_tape_end(tape,i)+1;
+    case JSON_INTEGER:
+    case JSON_DOUBLE:
+        return i+2;
+    default:
+        return i+1;
+    }
+}
+
+size_t json_tape_size(const JSON_Tape * tape,size_t i){
+    JSON_Element_Type type=json_tape_type(tape,i);
+    if(type!=JSON_ARRAY&&type!=JSON_OBJECT)return 0;
+    size_t count=TAPE_PAYLOAD(tape->tape[i])>>32;
+    if(count<TAPE_MAX_COUNT)return count;
+    count=0;
+    size_t end=json_tape_end(tape,i);
+    for(size_t c=json_tape_child(i);c<end;c=json_tape_next(tape,type==JSON_OBJECT?c+1:c)){
+        count++;
+    }
+    return count;
+}
+
+size_t json_tape_array_get(const JSON_Tape * tape,size_t arr,size_t index){
+    if(json_tape_type(tape,arr)!=JSON_ARRAY)return 0;
+    size_t end=json_tape_end(tape,arr);
+    for(size_t c=json_tape_child(arr);c<end;c=json_tape_next(tape,c)){
+        if(!index--)return c;
+    }
+    return 0;
+}
+
+size_t json_tape_object_get_n(const JSON_Tape * tape,size_t obj,const char * key,size_t n){
+    if(json_tape_type(tape,obj)!=JSON_OBJECT)return 0;
+    size_t end=json_tape_end(tape,obj);
+    for(size_t c=json_tape_child(obj);c<end;c=json_tape_next(tape,c+1)){
+        size_t len=0;
+        const char * k=json_tape_string(tape,c,&len);
+        if(len==n&&memcmp(k,key,n)==0)return c+1;
+    }
+    return 0;
+}
+
+size_t json_tape_object_get(const JSON_Tape * tape,size_t obj,const char * key){
+    return json_tape_object_get_n(tape,obj,key,strlen(key));
+}
+
+//converting to and from elements is iterative, like parsing, containers being walked are kept in an explicit stack
+//so the depth of a document is only limited by memory
+
+typedef struct to_element_frame {
+    JSON_Element * e;//points into the parent container, which isn't modified until this frame is done
+    size_t c;//next entry
+    size_t end;
+} to_element_frame;
+
+static JSON_Element * tape_node(const JSON_Tape * tape,size_t i,JSON_Element * e){//fills e, containers are left empty, returns an error element or NULL
+    const char * s;
+    size_t len=0;
+    switch(json_tape_type(tape,i)){
+    case JSON_ARRAY:
+        json_init_array(&e->_arr);
+        return NULL;
+    case JSON_OBJECT:
+        json_init_object(&e->_obj);
+        return NULL;
+    case JSON_STRING:
+        s=json_tape_string(tape,i,&len);
+        json_init_string_n(&e->_str,s,len);
+        return NULL;
+    case JSON_INTEGER:
+        e->_int.type=JSON_INTEGER;
+        e->_int.i=json_tape_integer(tape,i);
+        return NULL;
+    case JSON_DOUBLE:
+        e->_double.type=JSON_DOUBLE;
+        e->_double.d=json_tape_double(tape,i);
+        return NULL;
+    case JSON_NULL:
+    case JSON_TRUE:
+    case JSON_FALSE:
+        e->type=json_tape_type(tape,i);
+        return NULL;
+    default:
+        return parse_error("Invalid tape index %lu",(unsigned long)i);
+    }
+}
+
+JSON_Element * json_tape_to_element(const JSON_Tape * tape,size_t i){
+    JSON_Element * root=calloc(1,sizeof(JSON_Element));
+    if(!root){
+        OOM_EXIT();
+    }
+    root->type=JSON_NULL;
+    to_element_frame * stack=NULL;
+    size_t depth=0,alloc=0;
+    JSON_Element * err=tape_node(tape,i,root);
+    JSON_Element * e=root;
+    while(!err){
+        if(e&&(e->type==JSON_ARRAY||e->type==JSON_OBJECT)){
+            if(depth==alloc){
+                alloc=alloc?alloc*2:16;//growth factor 2
+                stack=realloc(stack,alloc*sizeof(to_element_frame));
+                if(!stack){
+                    OOM_EXIT();
+                }
+            }
+            stack[depth++]=(to_element_frame){.e=e,.c=json_tape_child(i),.end=json_tape_end(tape,i)};
+        }
+        if(!depth)break;
+        to_element_frame * f=&stack[depth-1];
+        if(f->c>=f->end){
+            depth--;
+            e=NULL;
+            continue;
+        }
+        if(f->e->type==JSON_ARRAY){
+            i=f->c;
+            e=json_array_emplace(&f->e->_arr);
+        }else{
+            size_t len=0;
+            const char * key=json_tape_string(tape,f->c,&len);
+            i=f->c+1;
+            e=json_object_emplace_n(&f->e->_obj,key,len);
+        }
+        f->c=json_tape_next(tape,i);
+        err=tape_node(tape,i,e);
+    }
+    free(stack);
+    if(err){
+        json_free_element(root);
+        return err;
+    }
+    return root;
+}
+
+typedef struct from_element_frame {
+    JSON_Element * e;
+    size_t index;
+    JSON_Object_Iterator it;
+} from_element_frame;
+
+static bool tape_from_node(tape_builder * b,JSON_Element * elem){//appends elem, opens containers without their entries, returns true for containers
+    if(b->depth) b->stack[b->depth-1].count++;
+    switch(elem->type){
+    case JSON_ARRAY:
+    case JSON_OBJECT:
+        tape_open(b,elem->type);
+        return true;
+    case JSON_PARSE_ERROR:
+    case JSON_STRING:
+        memcpy(tape_push_string(b,json_string_length(&elem->_str)),json_string_data(&elem->_str),json_string_length(&elem->_str));
+        return false;
+    case JSON_INTEGER:
+        tape_push_raw(b,JSON_INTEGER,&elem->_int.i);
+        return false;
+    case JSON_DOUBLE:
+        tape_push_raw(b,JSON_DOUBLE,&elem->_double.d);
+        return false;
+    default:
+        tape_push(b,TAPE_WORD(elem->type,0));
+        return false;
+    }
+}
+
+static void tape_from_element(tape_builder * b,JSON_Element * elem){
+    from_element_frame * stack=NULL;
+    size_t depth=0,alloc=0;
+    JSON_Element tmp;
+    while(true){
+        if(elem&&tape_from_node(b,elem)){
+            if(depth==alloc){
+                alloc=alloc?alloc*2:16;//growth factor 2
+                stack=realloc(stack,alloc*sizeof(from_element_frame));
+                if(!stack){
+                    OOM_EXIT();
+                }
+            }
+            stack[depth++]=(from_element_frame){.e=elem,.index=0,.it={0}};
+        }
+        if(!depth)break;
+        from_element_frame * f=&stack[depth-1];
+        const char * key;
+        size_t n;
+        elem=NULL;
+        if(f->e->type==JSON_ARRAY){
+            if(f->index<f->e->_arr.size){
+                elem=json_array_item(&f->e->_arr,f->index++,&tmp);//packed items are numbers, tmp is done with before the next item
+            }
+        }else if(json_object_next_n(&f->e->_obj,&f->it,&key,&n,&elem)){
+            memcpy(tape_push_string(b,n),key,n);
+        }
+        if(!elem){
+            tape_close(b);
+            depth--;
+        }
+    }
+    free(stack);
+}
+
+JSON_Tape * json_tape_from_element(JSON_Element * elem){
+    tape_builder b;
+    tape_builder_init(&b);
+    tape_from_element(&b,elem);
+    free(b.stack);
+    return b.t;
+}
@@ -1,4 +1,4 @@
-#include "json.h"
+#include "json.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -15,14 +15,16 @@ static std::string readfile(const std::string &filename){
 
 int main() {
     std::string file=readfile("test.json");
-    JSON_Element * elem=json_parse_n(file.c_str(),file.size());
-    FILE * f=fopen("test_out.json","w");
-    if(!f){
-        json_free_element(elem);
-        throw std::runtime_error(strerror(errno));
+    json::Document doc;
+    try{
+        doc=json::Document::parse(file);
+    }catch(const json::parse_error &e){
+        std::cerr<<"test.json: "<<e.what()<<std::endl;
+        return 1;
     }
-    json_write_element(f,elem,0);
-    json_free_element(elem);
+    FILE * f=fopen("test_out.json","w");
+    if(!f)throw std::runtime_error(strerror(errno));
+    doc.write(f);
     fclose(f);
     return 0;
 }
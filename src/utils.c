@@ -7,7 +7,7 @@
 size_t str_hash(const char * s){
     size_t hash = 5381;
     // hash * 33 + c
-    while(*s++)hash = ((hash << 5) + hash) + ((size_t)*s);
+    while(*s)hash = ((hash << 5) + hash) + ((size_t)(unsigned char)*s++);
     return hash;
 }
 
@@ -0,0 +1,84 @@
+//gcc -std=c99 -Iinclude src/*.c tests/json_binary_test.c -lm -pthread -o json_binary_test && ./json_binary_test
+
+#include "json.h"
+#include "json_binary.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures=0;
+
+static void check(int ok,const char * what){
+    if(!ok){
+        printf("FAIL: %s\n",what);
+        failures++;
+    }
+}
+
+static uint64_t get_u64(const uint8_t * p){
+    uint64_t v;
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+static void put_u64(uint8_t * p,uint64_t v){
+    memcpy(p,&v,sizeof(v));
+}
+
+static int is_error(JSON_Element * e){
+    int r=e->type==JSON_PARSE_ERROR;
+    json_free_element(e);
+    return r;
+}
+
+//offsets pointing at the same node would make the tree grow exponentially with the input
+static void shared_offsets(){
+    JSON_Element * doc=json_parse("[[[1,2],[3,4]],[[5,6],[7,8]]]");
+    size_t size;
+    uint8_t * data=json_write_binary_buffer(doc,&size);
+    check(!is_error(json_read_binary(data,size)),"valid document reads");
+    uint64_t root=get_u64(data+8);
+    put_u64(data+root+24,get_u64(data+root+16));//root[1] points at root[0]
+    check(is_error(json_read_binary(data,size)),"shared array is rejected");
+    JSON_Binary bin;
+    check(json_binary_open(&bin,data,size)==0,"shared array still opens");
+    check(json_binary_array_get(&bin,root,0)==json_binary_array_get(&bin,root,1),"in place access follows the offsets");
+    free(data);
+    json_free_element(doc);
+}
+
+//strings are documented as null-terminated
+static void unterminated_string(){
+    JSON_Element * doc=json_parse("[\"abc\",{\"k\":\"v\"}]");
+    size_t size;
+    uint8_t * data=json_write_binary_buffer(doc,&size);
+    JSON_Binary bin;
+    check(json_binary_open(&bin,data,size)==0,"document opens");
+    uint64_t s=json_binary_array_get(&bin,json_binary_root(&bin),0);
+    size_t len;
+    check(json_binary_string(&bin,s,&len)!=NULL&&len==3,"terminated string reads");
+    data[s+16+3]='x';
+    check(json_binary_string(&bin,s,&len)==NULL,"unterminated string is rejected");
+    check(is_error(json_read_binary(data,size)),"unterminated string fails the read");
+    data[s+16+3]=0;
+    uint64_t obj=json_binary_array_get(&bin,json_binary_root(&bin),1);
+    const char * key=json_binary_object_key(&bin,obj,0,&len);
+    check(key&&len==1,"key reads");
+    data[(key-(const char *)data)+1]='x';
+    check(json_binary_object_key(&bin,obj,0,&len)==NULL,"unterminated key is rejected");
+    check(json_binary_object_get(&bin,obj,"k")==0,"unterminated key isn't found");
+    check(is_error(json_read_binary(data,size)),"unterminated key fails the read");
+    free(data);
+    json_free_element(doc);
+}
+
+int main(){
+    shared_offsets();
+    unterminated_string();
+    if(failures){
+        printf("%d failed\n",failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,59 @@
+//gcc -std=c99 -Iinclude src/*.c tests/json_patch_test.c -lm -pthread -o json_patch_test && ./json_patch_test
+
+#include "json.h"
+#include "json_patch.h"
+#include <stdio.h>
+
+static int failures=0;
+
+static void check(int ok,const char * what){
+    if(!ok){
+        printf("FAIL: %s\n",what);
+        failures++;
+    }
+}
+
+//a failed move must leave the source where it was, target only keeps the operations before it
+static void move_to_missing_parent(){
+    JSON_Element * doc=json_parse("{\"a\":{\"b\":1},\"c\":[1,2,3]}");
+    JSON_Element * expected=json_parse("{\"a\":{\"b\":1},\"c\":[1,2,3],\"d\":4}");
+    int r=json_patch_apply(doc,json_parse("[{\"op\":\"add\",\"path\":\"/d\",\"value\":4},{\"op\":\"move\",\"from\":\"/a/b\",\"path\":\"/missing/b\"}]"));
+    check(r==1,"move to a missing parent fails");
+    check(json_equal(doc,expected),"move to a missing parent keeps the source");
+    r=json_patch_apply(doc,json_parse("[{\"op\":\"move\",\"from\":\"/c/1\",\"path\":\"/a/b/x\"}]"));
+    check(r==1,"move into a number fails");
+    r=json_patch_apply(doc,json_parse("[{\"op\":\"move\",\"from\":\"/c/0\",\"path\":\"/c/5\"}]"));
+    check(r==1,"move past the end of an array fails");
+    check(json_equal(doc,expected),"failed array moves keep the source at its index");
+    json_free_element(doc);
+    json_free_element(expected);
+}
+
+//test and the source of copy only read, packed arrays stay packed and clones keep sharing
+static void read_only_locations(){
+    JSON_Element * doc=json_parse_flags("{\"n\":[1,2,3],\"o\":{\"x\":1}}",JSON_PARSE_PACK_NUMBERS);
+    JSON_Element * copy=json_clone(doc);
+    JSON_Array * n=&json_object_get(&doc->_obj,"n")->_arr;
+    int r=json_patch_apply(doc,json_parse("[{\"op\":\"test\",\"path\":\"/n/1\",\"value\":2},{\"op\":\"test\",\"path\":\"/o/x\",\"value\":1}]"));
+    check(r==0,"test on packed items");
+    check(json_array_as_ints(n)!=NULL,"test keeps arrays packed");
+    check(json_object_get(&doc->_obj,"o")==json_object_get(&copy->_obj,"o"),"test doesn't unshare the path");
+    r=json_patch_apply(doc,json_parse("[{\"op\":\"copy\",\"from\":\"/n/2\",\"path\":\"/o/y\"}]"));
+    check(r==0,"copy from a packed item");
+    check(json_array_as_ints(&json_object_get(&doc->_obj,"n")->_arr)!=NULL,"copy keeps its source packed");
+    check(json_object_get(&json_object_get(&doc->_obj,"o")->_obj,"y")->_int.i==3,"copy from a packed item copies it");
+    check(!json_object_get(&json_object_get(&copy->_obj,"o")->_obj,"y"),"copy doesn't change clones");
+    json_free_element(doc);
+    json_free_element(copy);
+}
+
+int main(){
+    move_to_missing_parent();
+    read_only_locations();
+    if(failures){
+        printf("%d failed\n",failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,65 @@
+//gcc -std=c99 -Iinclude src/*.c tests/json_schema_test.c -lm -pthread -o json_schema_test && ./json_schema_test
+
+#include "json.h"
+#include "json_schema.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures=0;
+
+static void check(int ok,const char * what){
+    if(!ok){
+        printf("FAIL: %s\n",what);
+        failures++;
+    }
+}
+
+//checks a document with the streaming, the building and the tree validators, returns the number that accepted it
+static int accepted(const JSON_Schema * s,const char * doc){
+    int n=0;
+    JSON_Element * err=json_validate(doc,s);
+    if(!err)n++;
+    json_free_element(err);
+    JSON_Element * e=json_parse_validated(doc,s);
+    if(e&&e->type!=JSON_PARSE_ERROR)n++;
+    json_free_element(e);
+    e=json_parse(doc);
+    err=json_schema_validate(s,e);
+    if(!err)n++;
+    json_free_element(err);
+    json_free_element(e);
+    return n;
+}
+
+//each object only checks its own properties, whatever the nesting
+static void nested_required(){
+    JSON_Element * schema=json_parse(
+        "{\"type\":\"object\",\"required\":[\"b\"],\"additionalProperties\":false,\"properties\":{"
+            "\"a\":{\"type\":\"object\",\"required\":[\"x\"],\"additionalProperties\":false,\"properties\":{"
+                "\"x\":{\"type\":\"object\",\"required\":[\"y\"],\"properties\":{\"y\":{\"type\":\"integer\"}}}}},"
+            "\"b\":{\"type\":\"string\"}}}");
+    JSON_Schema * s=json_schema_compile(schema,NULL);
+    check(s!=NULL,"nested schema compiles");
+    check(accepted(s,"{\"b\":\"s\"}")==3,"nested required only applies to its object");
+    check(accepted(s,"{\"a\":{\"x\":{\"y\":1}},\"b\":\"s\"}")==3,"valid nested document");
+    check(accepted(s,"{\"a\":{\"x\":{\"y\":1}}}")==0,"missing top level required");
+    check(accepted(s,"{\"a\":{},\"b\":\"s\"}")==0,"missing nested required");
+    check(accepted(s,"{\"a\":{\"x\":{}},\"b\":\"s\"}")==0,"missing second level required");
+    check(accepted(s,"{\"a\":{\"x\":{\"y\":1}},\"b\":\"s\",\"x\":1}")==0,"nested keys are additional at the top");
+    check(accepted(s,"{\"a\":{\"x\":{\"y\":1},\"b\":\"s\"},\"b\":\"s\"}")==0,"parent keys are additional in a child");
+    JSON_Element * err=json_validate("{\"a\":{\"x\":{\"y\":1}}}",s);
+    check(err&&strstr(json_string_data(&err->_str),"'b'")!=NULL,"reports the top level key");
+    json_free_element(err);
+    json_schema_free(s);
+    json_free_element(schema);
+}
+
+int main(){
+    nested_required();
+    if(failures){
+        printf("%d failed\n",failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}